@@ -14,8 +14,59 @@
 #include <array>
 #include <map>
 #include <unordered_map>
+#include <set>
+#include <list>
+#include <unordered_set>
 #include <chrono>
 #include <iomanip>
+#include <vector>
+#include <thread>
+#include <semaphore>
+#include <compare>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <utility>
+#include <source_location>
+#include <limits>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include <charconv>
+#include <ctime>
+#include <variant>
+#include <any>
+#include <bitset>
+#include <queue>
+#include <stack>
+#include <cmath>
+#include <algorithm>
+#include <bit>
+#if __has_include(<expected>)
+#include <expected>
+#endif
+#if __has_include(<cxxabi.h>)
+#include <cxxabi.h>
+#endif
+#include <atomic>
+#include <cstring>
+#include <cstdio>
+#include <functional>
+#include <system_error>
+#if __has_include(<unistd.h>)
+#include <unistd.h>
+#include <cerrno>
+#endif
+#if __has_include(<sys/socket.h>)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#endif
 /////////////////////// CONCEPT ////////////////////////////////////////////
 namespace ju {
 namespace _concept {
@@ -50,7 +101,7 @@ namespace _concept {
             // 1. 指向字符类型的指针（C 字符串）
             (std::is_pointer_v<T> && CharacterType<std::remove_cvref_t<std::remove_pointer_t<T>>>) ||
             // 2. 字符数组（如 char[10], const char[5]）
-            (std::is_array_v<T> && CharacterType<std::remove_extent_t<T>>) ||
+            (std::is_array_v<T> && CharacterType<std::remove_cv_t<std::remove_extent_t<T>>>) ||
             // 3. std::basic_string
             IsBasicString<T> ||
             // 4. std::basic_string_view
@@ -58,6 +109,7 @@ namespace _concept {
         static_assert(stringlike::string_like<std::string&>);
         static_assert(stringlike::string_like<std::string_view>);
         static_assert(stringlike::string_like<char[3]>);
+        static_assert(stringlike::string_like<const char[3]>);
         static_assert(stringlike::string_like<const char*>);
         static_assert(stringlike::string_like<const char16_t*>);
         static_assert(stringlike::string_like<const volatile char8_t*>);
@@ -67,6 +119,14 @@ namespace _concept {
     template <typename T>
     concept string_like = stringlike::string_like<std::remove_reference_t<T>>;
 
+    // One-byte element types that can be shown as raw bytes
+    template <typename T>
+    concept byte_like = sizeof(T) == 1 && (std::same_as<T, std::byte> || (std::is_integral_v<T> && !std::same_as<T, bool>));
+
+    template <typename R>
+    concept byte_buffer = std::ranges::contiguous_range<R> && std::ranges::sized_range<R> &&
+                          byte_like<std::remove_cv_t<std::ranges::range_value_t<R>>>;
+
 namespace std_t {
     template<typename T, template <typename...> class Template>
     struct is_instance_of : std::false_type {};
@@ -85,6 +145,16 @@ namespace std_t {
     template <typename T>
     concept is_map = any_of_container<T, std::map, std::multimap, std::unordered_map, std::unordered_multimap>;
 
+    template <typename T>
+    concept is_set = any_of_container<T, std::set, std::multiset, std::unordered_set, std::unordered_multiset>;
+
+    template <typename T>
+    concept is_unordered = any_of_container<T, std::unordered_map, std::unordered_multimap, std::unordered_set,
+                                            std::unordered_multiset>;
+
+    template <typename T>
+    concept is_multi = any_of_container<T, std::multimap, std::unordered_multimap, std::multiset, std::unordered_multiset>;
+
     template <typename T>
     struct is_time_point : std::false_type {};
 
@@ -93,6 +163,23 @@ namespace std_t {
 
     template <typename T>
     concept is_chrono_time_point = is_time_point<std::decay_t<T>>::value;
+
+    template <typename T>
+    struct is_bitset : std::false_type {};
+
+    template <size_t N>
+    struct is_bitset<std::bitset<N>> : std::true_type {};
+
+    template <typename T>
+    concept is_container_adaptor = any_of_container<T, std::queue, std::stack, std::priority_queue>;
+
+#if defined(__cpp_lib_expected)
+    template <typename T>
+    concept is_expected = is_instance_of<T, std::expected>::value;
+#else
+    template <typename T>
+    concept is_expected = false;
+#endif
 }
 
 }
@@ -115,6 +202,16 @@ concept FlushablePolicy = PrintPolicy<P> && requires(P& p) {
     { p.flush() } -> std::same_as<void>;
 };
 
+// Customisation point for user types, checked before every built-in rule.
+// Specialise with a member
+//     template <typename Sink> void format(Sink& out, const T& value);
+// or provide eprint_format(Sink& out, const T& value) found by ADL. The sink
+// forwards write() to the printer's policy and print() recurses into members.
+namespace ju {
+template <typename T>
+struct formatter;
+}
+
 // Character literals traits - works for any CharT
 template <typename CharT>
 struct literals {
@@ -133,9 +230,14 @@ struct literals {
     static constexpr CharT close_paren[] = {')', 0};
     static constexpr CharT address_prefix[] = {'{',' ','a','d','d','r','e','s','s',':',' ', 0};
     static constexpr CharT count_prefix[] = {',',' ','c','o','u','n','t',':',' ', 0};
+    static constexpr CharT value_prefix[] = {',',' ','v','a','l','u','e',':',' ', 0};
+    static constexpr CharT cycle_prefix[] = {'<','c','y','c','l','e',' ','@', 0};
+    static constexpr CharT unexpected_prefix[] = {'u','n','e','x','p','e','c','t','e','d','(', 0};
+    static constexpr CharT any_prefix[] = {'<','a','n','y',':',' ', 0};
     static constexpr CharT at[] = {' ','a','t',' ', 0};
     static constexpr CharT lt[] = {'<', 0};
     static constexpr CharT gt[] = {'>', 0};
+    static constexpr CharT spaces[] = {' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ',' ', 0};
 };
 
 // Built-in policies
@@ -161,152 +263,1370 @@ struct ostream_policy {
     void flush() { os_.flush(); }
 };
 
-/////////////////////// POLICY /////////////////////////////////////////////
+// Flight recorder: keeps the most recent output (capacity rounded up to a
+// power of two) in a lock-free circular buffer. Each thread stages a line in
+// one of the ring's staging slots; at the newline the line is committed with
+// one atomic add and one memcpy (two at the wrap point). dump() only uses
+// atomic loads and write(2), so it may be called from a signal handler. A
+// line cut by the wrap-around is dropped from dumps; unterminated staged
+// lines are appended to them.
+// Not copyable: print through a reference, e.g. ju::make_printer(ring).
+class ring_policy {
+public:
+    using char_type = char;
 
-namespace ju {
+    static constexpr size_t line_capacity = 4096;
+    static constexpr size_t staging_slots = 16;
 
-namespace _inner {
-/////////////////////// AGGREGATE TYPE /////////////////////////////////////
-template <typename T>
-constexpr std::string_view get_raw_name() {
-#ifdef _MSC_VER
-    return __FUNCSIG__;
-#else
-    return __PRETTY_FUNCTION__;
-#endif
-}
+    explicit ring_policy(size_t capacity = size_t(1) << 20)
+        : capacity_(std::bit_ceil(std::max<size_t>(capacity, 64))),
+          mask_(capacity_ - 1),
+          buffer_(new char[capacity_]),
+          staged_(new staged_line[staging_slots]) {}
 
-template <typename T>
-constexpr std::string_view get_type_name() { // don't pass in type with reference
-    constexpr std::string_view sample = get_raw_name<int>();
-    constexpr size_t prefix_length = sample.find("int");
-    constexpr std::string_view str = get_raw_name<T>();
-    constexpr size_t suffix_length = sample.size() - prefix_length - 3;
-    constexpr auto name =
-        str.substr(prefix_length, str.size() - prefix_length - suffix_length);
+    ring_policy(const ring_policy&) = delete;
+    ring_policy& operator=(const ring_policy&) = delete;
 
-    return name;
-}
-//---members_count---start
-namespace detail {
-    struct UniversalType {
-        template <typename T>
-        operator T();
+    // One println is several writes, so text is staged per thread and
+    // committed to the ring once per line; concurrent printers never
+    // interleave inside a line shorter than line_capacity. A thread holds a
+    // slot only while it has an unterminated line; with every slot taken,
+    // text goes to the ring unstaged.
+    void write(std::string_view sv) noexcept {
+        size_t slot = claim();
+        if (slot == staging_slots) {
+            commit(sv);
+            return;
+        }
+        staged_line& line = staged_[slot];
+        size_t size = line.size.load(std::memory_order_relaxed);
+        while (!sv.empty()) {
+            size_t end = sv.find('\n');
+            size_t take = end == std::string_view::npos ? sv.size() : end + 1;
+            take = std::min(take, line_capacity - size);
+            std::memcpy(line.data + size, sv.data(), take);
+            size += take;
+            sv.remove_prefix(take);
+            if (line.data[size - 1] == '\n' || size == line_capacity) {
+                commit(std::string_view(line.data, size));
+                size = 0;
+            }
+            line.size.store(size, std::memory_order_release);
+        }
+        if (size == 0) {
+            owners_[slot].store(0, std::memory_order_release);
+        }
+    }
+
+    size_t capacity() const noexcept { return capacity_; }
+
+    // Total bytes committed, including overwritten ones
+    uint64_t written() const noexcept { return head_.load(std::memory_order_acquire); }
+
+    void clear() noexcept { head_.store(0, std::memory_order_release); }
+
+    // Retained text, oldest first, starting at a line boundary, then the
+    // staged unterminated lines, each closed with a newline
+    std::string snapshot() const {
+        std::string out;
+        visit([&](const char* data, size_t size) { out.append(data, size); });
+        return out;
+    }
+
+#if __has_include(<unistd.h>)
+    // Async-signal-safe, errno included; returns the number of bytes written
+    size_t dump(int fd) const noexcept {
+        int saved_errno = errno;
+        size_t total = 0;
+        visit([&](const char* data, size_t size) {
+            while (size != 0) {
+                ssize_t n = ::write(fd, data, size);
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) return;
+                data += n;
+                size -= n;
+                total += n;
+            }
+        });
+        errno = saved_errno;
+        return total;
+    }
+#endif
+
+private:
+    struct staged_line {
+        std::atomic<size_t> size{0};
+        char data[line_capacity];
     };
 
-    template <typename T, typename UniversalParam, typename = void, typename ...Args>
-    struct is_constructable: std::false_type {};
+    static uint64_t thread_token() noexcept {
+        static std::atomic<uint64_t> next{1};
+        thread_local uint64_t token = next.fetch_add(1, std::memory_order_relaxed);
+        return token;
+    }
 
-    template <typename T, typename UniversalParam, typename ...Args>
-    struct is_constructable<
-        T,
-        UniversalParam,
-        std::void_t<decltype(T{{Args{}}..., {UniversalParam{}}})>,
-        Args...> : std::true_type {};
+    // Index of this thread's staging slot, claiming a free one if it holds
+    // none; staging_slots if every slot is taken
+    size_t claim() noexcept {
+        uint64_t token = thread_token();
+        size_t free = staging_slots;
+        for (size_t i = 0; i < staging_slots; ++i) {
+            uint64_t owner = owners_[i].load(std::memory_order_acquire);
+            if (owner == token) return i;
+            if (owner == 0 && free == staging_slots) free = i;
+        }
+        for (size_t i = free; i < staging_slots; ++i) {
+            uint64_t expected = 0;
+            if (owners_[i].compare_exchange_strong(expected, token, std::memory_order_acq_rel)) {
+                return i;
+            }
+        }
+        return staging_slots;
+    }
 
-    template <typename T, typename UniversalParam, typename ...Args>
-    constexpr bool is_constructable_v = is_constructable<T, UniversalParam, void, Args...>::value;
+    // Reserves space with one atomic add and copies the record in
+    void commit(std::string_view sv) noexcept {
+        if (sv.size() > capacity_) {
+            sv.remove_prefix(sv.size() - capacity_);
+        }
+        uint64_t start = head_.fetch_add(sv.size(), std::memory_order_acq_rel);
+        size_t pos = start & mask_;
+        size_t first = std::min(sv.size(), capacity_ - pos);
+        std::memcpy(buffer_.get() + pos, sv.data(), first);
+        if (first < sv.size()) {
+            std::memcpy(buffer_.get(), sv.data() + first, sv.size() - first);
+        }
+    }
 
-    template <typename T, typename ...Args>
-    constexpr size_t members_count_impl() {
-        if constexpr (is_constructable_v<T, UniversalType, Args...>) {
-            return members_count_impl<T, Args..., UniversalType>();
+    // Calls f with the retained text in at most two segments, then with
+    // each staged line
+    template <typename F>
+    void visit(F&& f) const noexcept {
+        uint64_t head = head_.load(std::memory_order_acquire);
+        size_t size = static_cast<size_t>(std::min<uint64_t>(head, capacity_));
+        size_t begin = (head - size) & mask_;
+        if (head > capacity_) {
+            while (size != 0 && buffer_[begin] != '\n') {
+                begin = (begin + 1) & mask_;
+                --size;
+            }
+            if (size != 0) {
+                begin = (begin + 1) & mask_;
+                --size;
+            }
+        }
+        size_t first = std::min(size, capacity_ - begin);
+        if (first != 0) f(buffer_.get() + begin, first);
+        if (first < size) f(buffer_.get(), size - first);
+        for (size_t i = 0; i < staging_slots; ++i) {
+            if (owners_[i].load(std::memory_order_acquire) == 0) continue;
+            size_t staged = staged_[i].size.load(std::memory_order_acquire);
+            if (staged != 0) {
+                f(staged_[i].data, staged);
+                f("\n", 1);
+            }
+        }
+    }
+
+    size_t capacity_;
+    size_t mask_;
+    std::unique_ptr<char[]> buffer_;
+    std::atomic<uint64_t> head_{0};
+    std::array<std::atomic<uint64_t>, staging_slots> owners_{}; // thread token per slot, 0 = free
+    std::unique_ptr<staged_line[]> staged_;
+};
+
+struct rotating_file_options {
+    std::filesystem::path path;           // active file; old ones are path.1 ... path.N
+    size_t max_bytes = size_t(10) << 20;  // roll over once a line ends past this size
+    std::chrono::seconds max_age{0};      // or once the file is this old (0 = never)
+    unsigned generations = 5;             // rotated files to keep
+    bool flush_lines = false;             // fflush after every line
+    // Called on the helper thread with each freshly rotated file (path.1),
+    // e.g. to compress it; the next rotation waits until it returns
+    std::function<void(const std::filesystem::path&)> on_rotated{};
+};
+
+// Size/age-capped log files. A helper thread keeps the next file open in
+// advance and does the closing, renaming and on_rotated work, so a
+// rollover on the writing thread is a pointer swap. If the helper is still
+// busy the writer keeps appending to the current file and retries at the
+// next line end. Not copyable: print through a reference.
+class rotating_file_policy {
+public:
+    using char_type = char;
+
+    explicit rotating_file_policy(rotating_file_options options)
+        : options_(std::move(options)),
+          next_path_(options_.path.string() + ".next"),
+          file_(open(options_.path, "ab")),
+          opened_(std::chrono::steady_clock::now()) {
+        if (!file_) {
+            throw std::system_error(errno, std::generic_category(), "rotating_file_policy: " + options_.path.string());
+        }
+        size_ = static_cast<size_t>(std::ftell(file_));
+        helper_ = std::thread([this] { run_helper(); });
+    }
+
+    rotating_file_policy(const rotating_file_policy&) = delete;
+    rotating_file_policy& operator=(const rotating_file_policy&) = delete;
+
+    ~rotating_file_policy() {
+        stop_.store(true, std::memory_order_release);
+        wake();
+        helper_.join();
+        std::fclose(file_);
+        if (std::FILE* next = next_.exchange(nullptr)) {
+            std::fclose(next);
+            std::error_code ec;
+            std::filesystem::remove(next_path_, ec);
+        }
+    }
+
+    void write(std::string_view sv) {
+        std::fwrite(sv.data(), 1, sv.size(), file_);
+        size_ += sv.size();
+        if (!sv.ends_with('\n')) {
+            return;
+        }
+        if (options_.flush_lines) {
+            std::fflush(file_);
+        }
+        if (size_ >= options_.max_bytes ||
+            (options_.max_age.count() != 0 && std::chrono::steady_clock::now() - opened_ >= options_.max_age)) {
+            rotate();
+        }
+    }
+
+    // Flush buffered output of the active file
+    void sync() { std::fflush(file_); }
+
+    size_t rotations() const { return rotations_.load(std::memory_order_acquire); }
+
+private:
+    // path::c_str() is const wchar_t* on Windows
+    static std::FILE* open(const std::filesystem::path& path, const char* mode) {
+#ifdef _WIN32
+        std::wstring wide_mode(mode, mode + std::strlen(mode));
+        return _wfopen(path.c_str(), wide_mode.c_str());
+#else
+        return std::fopen(path.c_str(), mode);
+#endif
+    }
+
+    void rotate() {
+        std::FILE* next = next_.exchange(nullptr, std::memory_order_acq_rel);
+        if (!next) {
+            return; // helper still busy, try again at the next line end
+        }
+        retired_.store(file_, std::memory_order_release);
+        file_ = next;
+        size_ = 0;
+        opened_ = std::chrono::steady_clock::now();
+        wake();
+    }
+
+    void wake() {
+        signal_.fetch_add(1, std::memory_order_release);
+        signal_.notify_one();
+    }
+
+    void run_helper() {
+        uint32_t seen = signal_.load(std::memory_order_acquire);
+        while (true) {
+            if (std::FILE* old = retired_.exchange(nullptr, std::memory_order_acq_rel)) {
+                std::fclose(old);
+                shift_generations();
+                rotations_.fetch_add(1, std::memory_order_release);
+                if (options_.on_rotated) {
+                    options_.on_rotated(generation(1));
+                }
+            }
+            if (stop_.load(std::memory_order_acquire)) {
+                return;
+            }
+            if (!next_.load(std::memory_order_acquire)) {
+                if (std::FILE* next = open(next_path_, "wb")) {
+                    next_.store(next, std::memory_order_release);
+                } else {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                    continue;
+                }
+            }
+            signal_.wait(seen, std::memory_order_acquire);
+            seen = signal_.load(std::memory_order_acquire);
+        }
+    }
+
+    // path -> path.1 -> ... -> path.N, then the pre-opened file becomes path
+    void shift_generations() {
+        std::error_code ec;
+        if (options_.generations == 0) {
+            std::filesystem::remove(options_.path, ec);
         } else {
-            return sizeof...(Args);
+            std::filesystem::remove(generation(options_.generations), ec);
+            for (unsigned i = options_.generations; i > 1; --i) {
+                std::filesystem::rename(generation(i - 1), generation(i), ec);
+            }
+            std::filesystem::rename(options_.path, generation(1), ec);
         }
+        std::filesystem::rename(next_path_, options_.path, ec);
+    }
+
+    std::filesystem::path generation(unsigned i) const {
+        return options_.path.string() + "." + std::to_string(i);
     }
+
+    rotating_file_options options_;
+    std::filesystem::path next_path_;
+    std::FILE* file_;                          // writer thread only
+    size_t size_ = 0;
+    std::chrono::steady_clock::time_point opened_;
+    std::atomic<std::FILE*> next_{nullptr};    // opened ahead by the helper
+    std::atomic<std::FILE*> retired_{nullptr}; // handed to the helper to close
+    std::atomic<uint32_t> signal_{0};
+    std::atomic<bool> stop_{false};
+    std::atomic<size_t> rotations_{0};
+    std::thread helper_;
+};
+
+namespace ju {
+enum class level : uint8_t { trace, debug, info, warn, error, off };
 }
 
-template <typename T>
-requires std::is_aggregate_v<T>
-constexpr size_t members_count() {
-    if constexpr (std::is_empty_v<T>) {
-        return 0;
+namespace ju::_inner {
+
+// Branch-free so the scan vectorizes
+template <typename CharT>
+bool _is_ascii(std::basic_string_view<CharT> text) {
+    using unit = std::make_unsigned_t<CharT>;
+    unit bits = 0;
+    for (CharT c : text) bits |= unit(c);
+    return bits < 0x80;
+}
+
+// Code point at text[i] and the units it takes: UTF-8 for one-byte
+// characters, UTF-16 for two-byte ones, UTF-32 otherwise. A malformed unit
+// decodes to U+FFFD on its own.
+template <typename CharT>
+std::pair<char32_t, size_t> _decode(std::basic_string_view<CharT> text, size_t i) {
+    using unit = std::make_unsigned_t<CharT>;
+    constexpr char32_t replacement = 0xFFFD;
+    char32_t c = unit(text[i]);
+    if constexpr (sizeof(CharT) == 1) {
+        if (c < 0x80) return {c, 1};
+        size_t n = c >= 0xF8 ? 0 : c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC2 ? 2 : 0;
+        if (n == 0 || i + n > text.size()) return {replacement, 1};
+        c &= 0x7F >> n;
+        for (size_t k = 1; k < n; ++k) {
+            unit next = unit(text[i + k]);
+            if ((next & 0xC0) != 0x80) return {replacement, 1};
+            c = (c << 6) | (next & 0x3F);
+        }
+        constexpr char32_t smallest[] = {0, 0, 0x80, 0x800, 0x10000};
+        if (c < smallest[n] || c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF)) return {replacement, 1};
+        return {c, n};
+    } else if constexpr (sizeof(CharT) == 2) {
+        if (c < 0xD800 || c > 0xDFFF) return {c, 1};
+        if (c <= 0xDBFF && i + 1 < text.size()) {
+            char32_t low = unit(text[i + 1]);
+            if (low >= 0xDC00 && low <= 0xDFFF) return {0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00), 2};
+        }
+        return {replacement, 1};
     } else {
-        return detail::members_count_impl<T>();
+        if (c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF)) return {replacement, 1};
+        return {c, 1};
     }
 }
-template <typename T>
-constexpr size_t members_count_v = members_count<T>();
-//---members_count---end
-
-//---members_name---start
-template <auto ptr>
-inline constexpr std::string_view get_member_name() {
-#if defined(_MSC_VER)
-    constexpr std::string_view func_name = __FUNCSIG__;
-#else
-    constexpr std::string_view func_name = __PRETTY_FUNCTION__;
-#endif
 
-#if defined(__clang__)
-    auto split = func_name.substr(0, func_name.size() - 2);
-    return split.substr(split.find_last_of(":.") + 1);
-#elif defined(__GNUC__)
-    auto split = func_name.substr(0, func_name.rfind(")}"));
-    return split.substr(split.find_last_of(":") + 1);
-#elif defined(_MSC_VER)
-    auto split = func_name.substr(0, func_name.rfind("}>"));
-    return split.substr(split.rfind("->") + 2);
-#else
-    static_assert(false,
-                  "You are using an unsupported compiler. Please use GCC, Clang "
-                  "or MSVC or switch to the rfl::Field-syntax.");
-#endif
+// Appends code point c in the encoding _decode reads for CharT
+template <typename CharT>
+void _encode(char32_t c, std::basic_string<CharT>& out) {
+    if constexpr (sizeof(CharT) == 1) {
+        if (c < 0x80) {
+            out.push_back(CharT(c));
+        } else if (c < 0x800) {
+            out.push_back(CharT(0xC0 | (c >> 6)));
+            out.push_back(CharT(0x80 | (c & 0x3F)));
+        } else if (c < 0x10000) {
+            out.push_back(CharT(0xE0 | (c >> 12)));
+            out.push_back(CharT(0x80 | ((c >> 6) & 0x3F)));
+            out.push_back(CharT(0x80 | (c & 0x3F)));
+        } else {
+            out.push_back(CharT(0xF0 | (c >> 18)));
+            out.push_back(CharT(0x80 | ((c >> 12) & 0x3F)));
+            out.push_back(CharT(0x80 | ((c >> 6) & 0x3F)));
+            out.push_back(CharT(0x80 | (c & 0x3F)));
+        }
+    } else if constexpr (sizeof(CharT) == 2) {
+        if (c < 0x10000) {
+            out.push_back(CharT(c));
+        } else {
+            out.push_back(CharT(0xD800 + ((c - 0x10000) >> 10)));
+            out.push_back(CharT(0xDC00 + ((c - 0x10000) & 0x3FF)));
+        }
+    } else {
+        out.push_back(CharT(c));
+    }
 }
 
-template <typename T>
-struct wrapper {
-    inline static std::remove_cvref_t<T> value;
-};
+// Appends text converted between the encodings above; ASCII is copied unit
+// by unit
+template <typename To, typename From>
+void _transcode(std::basic_string_view<From> text, std::basic_string<To>& out) {
+    if (_is_ascii(text)) {
+        out.append(text.begin(), text.end());
+        return;
+    }
+    out.reserve(out.size() + text.size());
+    for (size_t i = 0; i < text.size();) {
+        auto [c, n] = _decode(text, i);
+        _encode(c, out);
+        i += n;
+    }
+}
 
-template <class T>
-inline constexpr std::remove_cvref_t<T>& get_fake_object() noexcept {
-    // return wrapper<std::remove_cvref_t<T>>::value;
-    return wrapper<T>::value; //Change
 }
 
-template <class T, std::size_t n>
-struct object_tuple_view_helper {
-    static constexpr auto tuple_view() {
-        static_assert(
-            sizeof(T) < 0,
-            "\n\nThis error occurs for one of two reasons:\n\n"
-            "1) You have created a struct with too many fields, which is "
-            "unsupported. \n\n"
-            "2) Your struct is not an aggregate type. You can make it aggregated, "
-            "or defined a YLT_REFL macro. \n\n");
+// Fan-out: output is formatted once, buffered until the printer flushes,
+// then handed to every sink as one view. Sinks with a different char_type
+// share a single copy per type, converted between UTF-8 (char), UTF-16 and
+// UTF-32 by code unit size. Each sink has a minimum level;
+// output printed while tee.level() is below it skips that sink. Sinks are
+// held by value or, when passed as lvalues, by reference.
+template <PrintPolicy... Ps>
+class tee_policy {
+    static_assert(sizeof...(Ps) > 0, "tee_policy needs at least one sink");
+    template <size_t I>
+    using sink_char = typename std::decay_t<std::tuple_element_t<I, std::tuple<Ps...>>>::char_type;
+
+    // First sink with the same char_type as sink I; its buffer is shared
+    template <size_t I>
+    static constexpr size_t buffer_owner() {
+        return []<size_t... Js>(std::index_sequence<Js...>) {
+            size_t owner = I;
+            ((owner = owner == I && std::same_as<sink_char<Js>, sink_char<I>> ? Js : owner), ...);
+            return owner;
+        }(std::make_index_sequence<I + 1>{});
     }
-};
 
-template <class T>
-struct object_tuple_view_helper<T, 0> {
-    static constexpr auto tuple_view() { return std::tie(); }
-    template <typename U>
-    static constexpr auto tuple_view(U&&) { return std::tie(); }
+public:
+    using char_type = sink_char<0>;
+
+    template <typename... Args>
+        requires(sizeof...(Args) == sizeof...(Ps) && sizeof...(Args) > 0 &&
+                 !(sizeof...(Args) == 1 && (std::same_as<std::decay_t<Args>, tee_policy> && ...)))
+    explicit tee_policy(Args&&... sinks) : sinks_(std::forward<Args>(sinks)...) {
+        levels_.fill(ju::level::trace);
+    }
+
+    void write(std::basic_string_view<char_type> sv) {
+        std::get<0>(buffers_).append(sv);
+    }
+
+    void flush() {
+        auto& text = std::get<0>(buffers_);
+        if (!text.empty()) {
+            [&]<size_t... Is>(std::index_sequence<Is...>) {
+                (dispatch<Is>(), ...);
+            }(std::index_sequence_for<Ps...>{});
+        }
+        [&]<size_t... Is>(std::index_sequence<Is...>) {
+            (std::get<Is>(buffers_).clear(), ...);
+        }(std::index_sequence_for<Ps...>{});
+    }
+
+    // Level of the output that follows
+    void level(ju::level lvl) { level_ = lvl; }
+    ju::level level() const { return level_; }
+
+    // Minimum level sink I accepts
+    template <size_t I>
+    void sink_level(ju::level lvl) { levels_[I] = lvl; }
+
+    template <size_t I>
+    auto& sink() { return std::get<I>(sinks_); }
+
+private:
+    template <size_t I>
+    void dispatch() {
+        if (level_ < levels_[I]) {
+            return;
+        }
+        constexpr size_t owner = buffer_owner<I>();
+        auto& buffer = std::get<owner>(buffers_);
+        if constexpr (owner != 0) {
+            if (buffer.empty()) {
+                const auto& text = std::get<0>(buffers_);
+                ju::_inner::_transcode(std::basic_string_view<char_type>(text), buffer);
+            }
+        }
+        auto& sink = std::get<I>(sinks_);
+        sink.write(std::basic_string_view<sink_char<I>>(buffer));
+        if constexpr (FlushablePolicy<std::decay_t<decltype(sink)>>) {
+            sink.flush();
+        }
+    }
+
+    std::tuple<Ps...> sinks_;
+    std::tuple<std::basic_string<typename std::decay_t<Ps>::char_type>...> buffers_;
+    std::array<ju::level, sizeof...(Ps)> levels_;
+    ju::level level_ = ju::level::info;
 };
 
-#define SPRINT_REFLECT_TUPLE_VIEW(n, ...) \
-template <typename T> \
-struct object_tuple_view_helper<T, n> { \
-    static constexpr auto tuple_view() { \
-        auto&[__VA_ARGS__] = get_fake_object<T>(); \
-        auto ref_tuple = std::tie(__VA_ARGS__); \
-        auto get_ptr = [] (auto&... fake_obj_ref) { \
-            return std::make_tuple(&fake_obj_ref...); \
-        }; \
-        return std::apply(get_ptr, ref_tuple); \
-    } \
-    template <typename U> \
-    static constexpr auto tuple_view(U&& t) { \
-        auto& [__VA_ARGS__] = t; \
-        return std::tie(__VA_ARGS__); \
-    } \
+template <typename... Ps>
+tee_policy(Ps&&...) -> tee_policy<Ps...>;
+
+#if __has_include(<sys/socket.h>)
+struct socket_options {
+    enum class transport { udp, tcp, unix_dgram, unix_stream };
+    transport kind = transport::udp;
+    std::string host = "127.0.0.1";  // udp / tcp
+    uint16_t port = 514;
+    std::string path{};               // unix sockets
+    size_t max_datagram = 1400;       // datagram payload limit, below the MTU
+    size_t batch = 16;                // datagrams per sendmmsg
+    size_t max_pending = 256 * 1024;  // bytes held back while the peer is slow
+    std::chrono::milliseconds max_delay{50}; // longest a complete line waits for its batch
 };
 
-////////////////// generate macros ////////////////////
+// Non-blocking network output. Whole lines are packed into datagrams of at
+// most max_datagram bytes and sent batch at a time (sendmmsg on Linux);
+// stream transports send whatever the kernel accepts. Data the socket
+// cannot take yet stays pending up to max_pending bytes, beyond that new
+// lines are dropped and counted, as are datagrams the socket rejects for
+// good (e.g. EMSGSIZE). The printer's flush() after each print sends the
+// complete lines once nothing went out for max_delay or the oldest has
+// waited that long, so a quiet logger sends at once and a busy one in
+// batches. Lines printed shortly after a send wait for the next print,
+// sync() or destruction. Not copyable: print through a reference.
+class socket_policy {
+public:
+    using char_type = char;
+    using transport = socket_options::transport;
 
-#ifndef __IDE_HELPER__a3b1f75c2e4d9a87bb5f6d0c94ef2176
+    explicit socket_policy(socket_options options) : options_(std::move(options)) {
+        bool is_unix = options_.kind == transport::unix_dgram || options_.kind == transport::unix_stream;
+        datagram_ = options_.kind == transport::udp || options_.kind == transport::unix_dgram;
+        fd_ = ::socket(is_unix ? AF_UNIX : AF_INET, datagram_ ? SOCK_DGRAM : SOCK_STREAM, 0);
+        if (fd_ < 0) {
+            throw std::system_error(errno, std::generic_category(), "socket_policy: socket");
+        }
+        ::fcntl(fd_, F_SETFL, ::fcntl(fd_, F_GETFL) | O_NONBLOCK);
+        int rc;
+        if (is_unix) {
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            std::strncpy(addr.sun_path, options_.path.c_str(), sizeof(addr.sun_path) - 1);
+            rc = ::connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        } else {
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(options_.port);
+            if (::inet_pton(AF_INET, options_.host.c_str(), &addr.sin_addr) != 1) {
+                ::close(fd_);
+                throw std::system_error(std::make_error_code(std::errc::invalid_argument),
+                                        "socket_policy: not an IPv4 address: " + options_.host);
+            }
+            rc = ::connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        }
+        if (rc < 0 && errno != EINPROGRESS) {
+            int err = errno;
+            ::close(fd_);
+            throw std::system_error(err, std::generic_category(), "socket_policy: connect");
+        }
+    }
+
+    socket_policy(const socket_policy&) = delete;
+    socket_policy& operator=(const socket_policy&) = delete;
+
+    ~socket_policy() {
+        sync();
+        ::close(fd_);
+    }
+
+    void write(std::string_view sv) {
+        line_.append(sv);
+        if (sv.ends_with('\n')) {
+            end_line();
+        }
+    }
+
+    // Sends the complete lines if the batch is due, see above
+    void flush() {
+        if (pending_.empty() && open_ == 0) {
+            return;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_send_ < options_.max_delay && now - oldest_ < options_.max_delay) {
+            return;
+        }
+        if (datagram_ && open_ != 0) {
+            close_datagram();
+        }
+        send_pending();
+    }
+
+    // Send everything pending, including an unfinished line
+    void sync() {
+        if (!line_.empty()) {
+            end_line();
+        }
+        if (datagram_ && open_ != 0) {
+            close_datagram();
+        }
+        send_pending();
+    }
+
+    uint64_t dropped_lines() const { return dropped_lines_; }
+    uint64_t sent_bytes() const { return sent_bytes_; }
+    uint64_t send_calls() const { return send_calls_; }
+
+private:
+    void end_line() {
+        if (pending_.empty()) {
+            oldest_ = std::chrono::steady_clock::now();
+        }
+        if (pending_.size() + line_.size() > options_.max_pending) {
+            send_pending();
+        }
+        if (pending_.size() + line_.size() > options_.max_pending) {
+            ++dropped_lines_;
+            line_.clear();
+            return;
+        }
+        if (!datagram_) {
+            pending_.append(line_);
+            line_.clear();
+            if (pending_.size() >= options_.max_datagram) {
+                send_pending();
+            }
+            return;
+        }
+        // Start a new datagram if the line does not fit the open one; split
+        // lines longer than a datagram
+        if (open_ != 0 && open_ + line_.size() > options_.max_datagram) {
+            close_datagram();
+        }
+        std::string_view rest = line_;
+        while (rest.size() > options_.max_datagram) {
+            pending_.append(rest.substr(0, options_.max_datagram));
+            open_ = options_.max_datagram;
+            close_datagram();
+            rest.remove_prefix(options_.max_datagram);
+        }
+        pending_.append(rest);
+        open_ += rest.size();
+        line_.clear();
+        if (frames_.size() >= options_.batch) {
+            send_pending();
+        }
+    }
+
+    void close_datagram() {
+        frames_.push_back(open_);
+        open_ = 0;
+    }
+
+    void send_pending() {
+        last_send_ = std::chrono::steady_clock::now();
+        size_t consumed = datagram_ ? send_datagrams() : send_stream();
+        pending_.erase(0, consumed);
+        if (!pending_.empty()) {
+            oldest_ = last_send_; // retry after max_delay, not on every print
+        }
+    }
+
+    // Errors that go away once the peer or the kernel catches up
+    static bool transient(int err) {
+        return err == EAGAIN || err == EWOULDBLOCK || err == EINTR || err == ENOBUFS || err == ENOTCONN ||
+               err == EINPROGRESS || err == ECONNREFUSED;
+    }
+
+    void drop(std::string_view text) {
+        dropped_lines_ += std::max<size_t>(1, std::count(text.begin(), text.end(), '\n'));
+    }
+
+    // Returns the bytes of the datagrams that were sent or dropped
+    size_t send_datagrams() {
+        size_t sent = 0;
+        size_t done = 0;
+        while (done < frames_.size()) {
+#if defined(__linux__)
+            mmsghdr msgs[64];
+            iovec iov[64];
+            size_t n = std::min<size_t>(frames_.size() - done, 64);
+            size_t offset = sent;
+            for (size_t i = 0; i < n; ++i) {
+                iov[i] = {pending_.data() + offset, frames_[done + i]};
+                msgs[i] = {};
+                msgs[i].msg_hdr.msg_iov = &iov[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+                offset += frames_[done + i];
+            }
+            int accepted = ::sendmmsg(fd_, msgs, n, MSG_DONTWAIT);
+            ++send_calls_;
+            if (accepted > 0) {
+                for (int i = 0; i < accepted; ++i) {
+                    sent_bytes_ += frames_[done + i];
+                    sent += frames_[done + i];
+                }
+                done += accepted;
+                continue;
+            }
+#else
+            ssize_t accepted = ::send(fd_, pending_.data() + sent, frames_[done], MSG_DONTWAIT);
+            ++send_calls_;
+            if (accepted >= 0) {
+                sent_bytes_ += frames_[done];
+                sent += frames_[done++];
+                continue;
+            }
+#endif
+            if (accepted == 0 || transient(errno)) {
+                break;
+            }
+            // Rejected for good: drop the first datagram so the rest can go
+            drop(std::string_view(pending_).substr(sent, frames_[done]));
+            sent += frames_[done++];
+        }
+        frames_.erase(frames_.begin(), frames_.begin() + done);
+        return sent;
+    }
+
+    size_t send_stream() {
+        size_t sent = 0;
+        while (sent < pending_.size()) {
+#if defined(MSG_NOSIGNAL)
+            ssize_t rc = ::send(fd_, pending_.data() + sent, pending_.size() - sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+#else
+            ssize_t rc = ::send(fd_, pending_.data() + sent, pending_.size() - sent, MSG_DONTWAIT);
+#endif
+            ++send_calls_;
+            if (rc > 0) {
+                sent_bytes_ += rc;
+                sent += rc;
+                continue;
+            }
+            if (rc < 0 && !transient(errno)) {
+                // The connection is gone: nothing pending can be delivered
+                drop(std::string_view(pending_).substr(sent));
+                sent = pending_.size();
+            }
+            break;
+        }
+        return sent;
+    }
+
+    socket_options options_;
+    int fd_ = -1;
+    bool datagram_ = true;
+    std::string line_;           // line being printed
+    std::string pending_;        // complete lines not yet sent
+    std::vector<size_t> frames_; // datagram sizes within pending_
+    size_t open_ = 0;            // bytes of the datagram still being filled
+    uint64_t dropped_lines_ = 0;
+    uint64_t sent_bytes_ = 0;
+    uint64_t send_calls_ = 0;
+    std::chrono::steady_clock::time_point last_send_{}; // last send attempt
+    std::chrono::steady_clock::time_point oldest_{};    // when pending_ got its first line
+};
+#endif
+
+/////////////////////// POLICY /////////////////////////////////////////////
+
+
+/////////////////////// FORMAT SPEC ////////////////////////////////////////
+namespace ju {
+
+namespace _inner {
+    // Not constexpr: reaching it while parsing a spec at compile time makes
+    // the call ill-formed, and the diagnostic names this function.
+    inline void invalid_format_spec() {}
+}
+
+// std::format-style spec: [[fill]align][sign][#][0][width][.precision][type]
+struct format_spec {
+    char fill = ' ';
+    char align = 0;      // '<', '>', '^', or 0 for the type's default
+    char sign = '-';     // '+', '-' or ' '
+    bool alternate = false;
+    bool zero_pad = false;
+    unsigned width = 0;
+    int precision = -1;
+    char type = 0;       // one of bBcdoxXaAeEfFgGps, or 0
+
+    format_spec() = default;
+    bool operator==(const format_spec&) const = default;
+
+    // Accepts "{:spec}", "{}" or a bare "spec"
+    template <size_t N>
+    consteval format_spec(const char (&str)[N]) { parse(std::string_view(str, N - 1)); }
+
+private:
+    consteval void parse(std::string_view s) {
+        if (s.starts_with('{')) {
+            if (!s.ends_with('}')) _inner::invalid_format_spec();
+            s = s.substr(1, s.size() - 2);
+            if (s.empty()) return;
+            if (s[0] != ':') _inner::invalid_format_spec();
+            s.remove_prefix(1);
+        }
+        auto is_align = [](char c) { return c == '<' || c == '>' || c == '^'; };
+        auto is_digit = [](char c) { return c >= '0' && c <= '9'; };
+        size_t i = 0;
+        if (s.size() >= 2 && is_align(s[1])) {
+            fill = s[0];
+            align = s[1];
+            i = 2;
+        } else if (!s.empty() && is_align(s[0])) {
+            align = s[0];
+            i = 1;
+        }
+        if (i < s.size() && (s[i] == '+' || s[i] == '-' || s[i] == ' ')) sign = s[i++];
+        if (i < s.size() && s[i] == '#') {
+            alternate = true;
+            ++i;
+        }
+        if (i < s.size() && s[i] == '0') {
+            zero_pad = true;
+            ++i;
+        }
+        while (i < s.size() && is_digit(s[i])) width = width * 10 + (s[i++] - '0');
+        if (i < s.size() && s[i] == '.') {
+            if (++i == s.size() || !is_digit(s[i])) _inner::invalid_format_spec();
+            precision = 0;
+            while (i < s.size() && is_digit(s[i])) precision = precision * 10 + (s[i++] - '0');
+        }
+        if (i < s.size()) {
+            type = s[i++];
+            if (std::string_view("bBcdoxXaAeEfFgGps").find(type) == std::string_view::npos) {
+                _inner::invalid_format_spec();
+            }
+        }
+        if (i != s.size()) _inner::invalid_format_spec();
+    }
+};
+
+template <typename T>
+struct formatted {
+    T value;
+    format_spec spec;
+};
+
+// ju::fmt(reg, "{:#010x}"): the spec applies to every number, character and
+// string printed inside value, so containers and aggregates are formatted
+// element by element.
+template <typename T>
+constexpr formatted<T> fmt(T&& value, format_spec spec) {
+    return {std::forward<T>(value), spec};
+}
+
+template <typename R>
+struct table_view {
+    R range;
+};
+
+// ju::table(rows): a range of aggregates as a table, one header line with
+// the member names and one line per element
+template <typename R>
+constexpr table_view<R> table(R&& range) {
+    return {std::forward<R>(range)};
+}
+
+enum class hexdump_style {
+    rows,     // offset, 16 hex bytes and their ASCII per line, like hexdump -C
+    compact,  // <n bytes: 0c00ff...>
+};
+
+struct hexdump_view {
+    const unsigned char* data;
+    size_t size;
+    hexdump_style style;
+};
+
+// ju::hexdump(buf): the raw bytes of a contiguous buffer of one-byte elements
+template <_concept::byte_buffer R>
+hexdump_view hexdump(const R& buffer, hexdump_style style = hexdump_style::rows) {
+    return {reinterpret_cast<const unsigned char*>(std::ranges::data(buffer)), std::ranges::size(buffer), style};
+}
+
+template <typename R>
+struct summary_view {
+    R range;
+};
+
+// ju::summary(samples): statistics and a histogram of a numeric range
+// instead of its elements
+template <typename R>
+constexpr summary_view<R> summary(R&& range) {
+    return {std::forward<R>(range)};
+}
+
+}
+/////////////////////// FORMAT SPEC ////////////////////////////////////////
+
+
+/////////////////////// FIXED STRING ///////////////////////////////////////
+namespace ju {
+
+// Fixed-capacity string usable as a template argument and in constant
+// expressions; the result type of ju::ct_format. Prints like a string.
+template <size_t N>
+struct fixed_string {
+    char data[N + 1]{};
+
+    constexpr fixed_string() = default;
+    constexpr fixed_string(const char (&str)[N + 1]) {
+        std::copy_n(str, N + 1, data);
+    }
+
+    static constexpr size_t size() { return N; }
+    constexpr std::string_view view() const { return {data, N}; }
+    constexpr operator std::string_view() const { return view(); }
+};
+
+template <size_t N>
+fixed_string(const char (&)[N]) -> fixed_string<N - 1>;
+
+namespace _concept::std_t {
+    template <typename T>
+    struct is_fixed_string : std::false_type {};
+
+    template <size_t N>
+    struct is_fixed_string<fixed_string<N>> : std::true_type {};
+}
+
+}
+/////////////////////// FIXED STRING ///////////////////////////////////////
+
+
+/////////////////////// FIELD ATTRIBUTES ///////////////////////////////////
+namespace ju {
+
+// What aggregate reflection does with one member, folded from the
+// attributes that name it
+struct field_plan {
+    std::string_view name;
+    bool skip = false;
+    bool redact = false;
+    size_t truncate = size_t(-1);
+    std::optional<format_spec> spec;
+    size_t formatter = size_t(-1); // index of a format_with attribute
+};
+
+namespace field {
+
+// Never read or formatted
+struct skip_t {
+    std::string_view field;
+    constexpr void apply(field_plan& plan, size_t) const { plan.skip = true; }
+};
+
+struct rename_t {
+    std::string_view field;
+    std::string_view to;
+    constexpr void apply(field_plan& plan, size_t) const { plan.name = to; }
+};
+
+// Printed as <redacted>
+struct redact_t {
+    std::string_view field;
+    constexpr void apply(field_plan& plan, size_t) const { plan.redact = true; }
+};
+
+// Ranges and strings keep their first n elements
+struct truncate_t {
+    std::string_view field;
+    size_t n;
+    constexpr void apply(field_plan& plan, size_t) const { plan.truncate = n; }
+};
+
+struct spec_t {
+    std::string_view field;
+    format_spec spec;
+    constexpr void apply(field_plan& plan, size_t) const { plan.spec = spec; }
+};
+
+// F::format(sink, member), as for ju::formatter
+template <typename F>
+struct format_with_t {
+    using formatter_type = F;
+    std::string_view field;
+    constexpr void apply(field_plan& plan, size_t self) const { plan.formatter = self; }
+};
+
+constexpr skip_t skip(std::string_view field) { return {field}; }
+constexpr rename_t rename(std::string_view field, std::string_view to) { return {field, to}; }
+constexpr redact_t redact(std::string_view field) { return {field}; }
+constexpr truncate_t truncate(std::string_view field, size_t n) { return {field, n}; }
+constexpr spec_t format(std::string_view field, format_spec spec) { return {field, spec}; }
+template <typename F>
+constexpr format_with_t<F> format_with(std::string_view field) { return {field}; }
+
+}
+
+// Specialise with a constexpr tuple of field:: attributes, e.g.
+//     template <> struct ju::field_attributes<Packet> {
+//         static constexpr auto value = std::tuple{ju::field::skip("payload"),
+//                                                  ju::field::redact("token")};
+//     };
+// Attributes are resolved at compile time; naming a member that does not
+// exist is a compile error.
+template <typename T>
+struct field_attributes {
+    static constexpr std::tuple<> value{};
+};
+
+}
+/////////////////////// FIELD ATTRIBUTES ///////////////////////////////////
+
+
+/////////////////////// OPTIONS ////////////////////////////////////////////
+namespace ju {
+
+struct print_options {
+    // Random-access ranges with at least this many elements are split into
+    // chunks and formatted on worker threads. 0 disables parallel formatting.
+    size_t parallel_threshold = 0;
+    // Number of workers, 0 means std::thread::hardware_concurrency().
+    unsigned parallel_threads = 0;
+    // Pretty mode: containers whose single-line form does not fit in this
+    // many columns are broken one element per line. 0 keeps single-line output.
+    size_t pretty_width = 0;
+    // Spaces per depth level in pretty mode.
+    size_t pretty_indent = 4;
+    // Print what smart pointers point to. Objects reached a second time
+    // (shared or cyclic) are printed as <cycle @address> back-references.
+    bool deep_pointers = false;
+    // Default specs for integers (not bool/char) and floating point values
+    // printed without a ju::fmt wrapper, e.g. ju::format_spec("{:.2f}").
+    std::optional<format_spec> integer_format;
+    std::optional<format_spec> float_format;
+    // Print contiguous ranges of one-byte integers as compact hex, the way
+    // ranges of std::byte always are.
+    bool bytes_as_hex = false;
+    // Print unordered containers in key order, so output does not depend on
+    // the hash function or the insertion history. Keys need operator<.
+    bool sort_unordered = false;
+
+    bool operator==(const print_options&) const = default;
+};
+
+}
+/////////////////////// OPTIONS ////////////////////////////////////////////
+
+
+/////////////////////// ALLOCATOR //////////////////////////////////////////
+namespace ju {
+
+// Per-thread bump arena for formatting temporaries. Blocks are kept after a
+// rewind, so once warmed up a print never reaches operator new.
+class arena {
+    struct block {
+        block* next;
+        size_t size;
+        std::byte* data() { return reinterpret_cast<std::byte*>(this + 1); }
+    };
+    block* head_ = nullptr;
+    block* current_ = nullptr;
+    size_t offset_ = 0;
+
+    block* new_block(size_t size) {
+        auto* b = static_cast<block*>(::operator new(sizeof(block) + size));
+        b->next = nullptr;
+        b->size = size;
+        return b;
+    }
+
+public:
+    static constexpr size_t block_size = 4096;
+
+    struct marker {
+        block* blk;
+        size_t offset;
+    };
+
+    arena() = default;
+    arena(const arena&) = delete;
+    arena& operator=(const arena&) = delete;
+    ~arena() {
+        while (head_) {
+            block* next = head_->next;
+            ::operator delete(head_);
+            head_ = next;
+        }
+    }
+
+    static arena& local() {
+        thread_local arena instance;
+        return instance;
+    }
+
+    void* allocate(size_t n, size_t align) {
+        if (current_) {
+            size_t start = (offset_ + align - 1) & ~(align - 1);
+            if (start + n <= current_->size) {
+                offset_ = start + n;
+                return current_->data() + start;
+            }
+        }
+        // Move on to the next kept block, or splice in a bigger one
+        block* next = current_ ? current_->next : head_;
+        if (!next || next->size < n + align) {
+            block* fresh = new_block(std::max(block_size, n + align));
+            fresh->next = next;
+            (current_ ? current_->next : head_) = fresh;
+            next = fresh;
+        }
+        current_ = next;
+        offset_ = 0;
+        return allocate(n, align);
+    }
+
+    marker mark() const { return {current_, offset_}; }
+
+    void rewind(marker m) {
+        current_ = m.blk;
+        offset_ = m.offset;
+    }
+};
+
+template <typename T>
+struct arena_allocator {
+    using value_type = T;
+
+    arena_allocator() = default;
+    template <typename U>
+    constexpr arena_allocator(const arena_allocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(arena::local().allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T*, size_t) noexcept {}
+
+    template <typename U>
+    bool operator==(const arena_allocator<U>&) const noexcept { return true; }
+};
+
+namespace _inner {
+    // Releases the temporaries of one print call; a no-op for other allocators.
+    template <typename Alloc>
+    struct alloc_scope {
+        constexpr alloc_scope() noexcept {}
+    };
+
+    template <typename T>
+    struct alloc_scope<arena_allocator<T>> {
+        arena::marker m = arena::local().mark();
+        alloc_scope() = default;
+        alloc_scope(const alloc_scope&) = delete;
+        ~alloc_scope() { arena::local().rewind(m); }
+    };
+}
+
+}
+/////////////////////// ALLOCATOR //////////////////////////////////////////
+
+namespace ju {
+
+namespace _inner {
+/////////////////////// AGGREGATE TYPE /////////////////////////////////////
+template <typename T>
+constexpr std::string_view get_raw_name() {
+#ifdef _MSC_VER
+    return __FUNCSIG__;
+#else
+    return __PRETTY_FUNCTION__;
+#endif
+}
+
+template <typename T>
+constexpr std::string_view get_type_name() { // don't pass in type with reference
+    constexpr std::string_view sample = get_raw_name<int>();
+    constexpr size_t prefix_length = sample.find("int");
+    constexpr std::string_view str = get_raw_name<T>();
+    constexpr size_t suffix_length = sample.size() - prefix_length - 3;
+    constexpr auto name =
+        str.substr(prefix_length, str.size() - prefix_length - suffix_length);
+
+    return name;
+}
+//---members_count---start
+namespace detail {
+    struct UniversalType {
+        template <typename T>
+        operator T();
+    };
+
+    // Plain (unbraced) initializer. Some members (shared_ptr, path,
+    // std::function) can't be list-initialized from {UniversalType} since
+    // several constructors match, but accept a plain conversion.
+    struct UniversalRvalue {
+        template <typename T>
+        operator T() const&&;
+    };
+
+    template <typename ...Args>
+    struct type_list {};
+
+    // Probes in runs that alternate braced, plain, braced, ...: {UniversalType}
+    // keeps a C array one member, UniversalRvalue reaches members that reject
+    // the braced form but would be brace-elided into an array's elements
+    template <typename ...Runs>
+    struct probe_runs {};
+
+    inline constexpr size_t probe_run_count = 8;
+
+    template <typename T, typename Runs, typename = void>
+    struct is_constructable: std::false_type {};
+
+    template <typename T, typename ...B0, typename ...P0, typename ...B1, typename ...P1,
+              typename ...B2, typename ...P2, typename ...B3, typename ...P3>
+    struct is_constructable<
+        T,
+        probe_runs<type_list<B0...>, type_list<P0...>, type_list<B1...>, type_list<P1...>,
+                   type_list<B2...>, type_list<P2...>, type_list<B3...>, type_list<P3...>>,
+        std::void_t<decltype(T{{B0{}}..., P0{}..., {B1{}}..., P1{}..., {B2{}}..., P2{}..., {B3{}}..., P3{}...})>>
+        : std::true_type {};
+
+    template <typename List, typename X>
+    struct push_back;
+
+    template <typename ...Args, typename X>
+    struct push_back<type_list<Args...>, X> {
+        using type = type_list<Args..., X>;
+    };
+
+    // Runs with X appended to run I
+    template <size_t I, typename X, typename ...Runs, size_t ...Is>
+    auto append_probe(probe_runs<Runs...>, std::index_sequence<Is...>)
+        -> probe_runs<std::conditional_t<Is == I, typename push_back<Runs, X>::type, Runs>...>;
+
+    template <typename Runs, size_t I, typename X>
+    using append_probe_t = decltype(append_probe<I, X>(Runs{}, std::make_index_sequence<probe_run_count>{}));
+
+    template <typename ...Args>
+    constexpr size_t list_size(type_list<Args...>) { return sizeof...(Args); }
+
+    template <typename ...Runs>
+    constexpr size_t probes_count(probe_runs<Runs...>) { return (list_size(Runs{}) + ...); }
+
+    // Each member is probed braced first, then plain; Current is the run the
+    // last probe went into (even runs are braced)
+    template <typename T, typename Runs, size_t Current>
+    constexpr size_t members_count_impl() {
+        constexpr size_t braced = Current % 2 == 0 ? Current : Current + 1;
+        constexpr size_t plain = Current % 2 == 1 ? Current : Current + 1;
+        if constexpr (braced < probe_run_count &&
+                      is_constructable<T, append_probe_t<Runs, braced, UniversalType>>::value) {
+            return members_count_impl<T, append_probe_t<Runs, braced, UniversalType>, braced>();
+        } else if constexpr (plain < probe_run_count &&
+                             is_constructable<T, append_probe_t<Runs, plain, UniversalRvalue>>::value) {
+            return members_count_impl<T, append_probe_t<Runs, plain, UniversalRvalue>, plain>();
+        } else {
+            return probes_count(Runs{});
+        }
+    }
+
+    template <size_t>
+    using empty_run = type_list<>;
+
+    template <size_t ...Is>
+    auto empty_runs(std::index_sequence<Is...>) -> probe_runs<empty_run<Is>...>;
+}
+
+template <typename T>
+requires std::is_aggregate_v<T>
+constexpr size_t members_count() {
+    if constexpr (std::is_empty_v<T>) {
+        return 0;
+    } else {
+        using none = decltype(detail::empty_runs(std::make_index_sequence<detail::probe_run_count>{}));
+        return detail::members_count_impl<T, none, 0>();
+    }
+}
+template <typename T>
+constexpr size_t members_count_v = members_count<T>();
+//---members_count---end
+
+//---members_name---start
+template <auto ptr>
+inline constexpr std::string_view get_member_name() {
+#if defined(_MSC_VER)
+    constexpr std::string_view func_name = __FUNCSIG__;
+#else
+    constexpr std::string_view func_name = __PRETTY_FUNCTION__;
+#endif
+
+#if defined(__clang__)
+    auto split = func_name.substr(0, func_name.size() - 2);
+    return split.substr(split.find_last_of(":.") + 1);
+#elif defined(__GNUC__)
+    auto split = func_name.substr(0, func_name.rfind(")}"));
+    return split.substr(split.find_last_of(":") + 1);
+#elif defined(_MSC_VER)
+    auto split = func_name.substr(0, func_name.rfind("}>"));
+    return split.substr(split.rfind("->") + 2);
+#else
+    static_assert(false,
+                  "You are using an unsupported compiler. Please use GCC, Clang "
+                  "or MSVC or switch to the rfl::Field-syntax.");
+#endif
+}
+
+template <typename T>
+struct wrapper {
+    inline static std::remove_cvref_t<T> value;
+};
+
+template <class T>
+inline constexpr std::remove_cvref_t<T>& get_fake_object() noexcept {
+    // return wrapper<std::remove_cvref_t<T>>::value;
+    return wrapper<T>::value; //Change
+}
+
+template <class T, std::size_t n>
+struct object_tuple_view_helper {
+    static constexpr auto tuple_view() {
+        static_assert(
+            sizeof(T) < 0,
+            "\n\nThis error occurs for one of two reasons:\n\n"
+            "1) You have created a struct with too many fields, which is "
+            "unsupported. \n\n"
+            "2) Your struct is not an aggregate type. You can make it aggregated, "
+            "or defined a YLT_REFL macro. \n\n");
+    }
+};
+
+template <class T>
+struct object_tuple_view_helper<T, 0> {
+    static constexpr auto tuple_view() { return std::tie(); }
+    template <typename U>
+    static constexpr auto tuple_view(U&&) { return std::tie(); }
+};
+
+#define SPRINT_REFLECT_TUPLE_VIEW(n, ...) \
+template <typename T> \
+struct object_tuple_view_helper<T, n> { \
+    static constexpr auto tuple_view() { \
+        auto&[__VA_ARGS__] = get_fake_object<T>(); \
+        auto ref_tuple = std::tie(__VA_ARGS__); \
+        auto get_ptr = [] (auto&... fake_obj_ref) { \
+            return std::make_tuple(&fake_obj_ref...); \
+        }; \
+        return std::apply(get_ptr, ref_tuple); \
+    } \
+    template <typename U> \
+    static constexpr auto tuple_view(U&& t) { \
+        auto& [__VA_ARGS__] = t; \
+        return std::tie(__VA_ARGS__); \
+    } \
+};
+
+////////////////// generate macros ////////////////////
+
+#ifndef __IDE_HELPER__a3b1f75c2e4d9a87bb5f6d0c94ef2176
 
 SPRINT_REFLECT_TUPLE_VIEW(1, f0);
 SPRINT_REFLECT_TUPLE_VIEW(2, f0, f1);
@@ -393,323 +1713,3486 @@ SPRINT_REFLECT_TUPLE_VIEW(
 
 #endif
 
-////////////////// generate macros ////////////////////
-template <class T>
-struct Wrapper {
-    using Type = T;
-    T v;
+////////////////// generate macros ////////////////////
+template <class T>
+struct Wrapper {
+    using Type = T;
+    T v;
+};
+
+template <class T>
+Wrapper(T) -> Wrapper<T>;
+
+// This workaround is necessary for clang.
+template <class T>
+inline constexpr auto wrap(const T& arg) noexcept {
+    return Wrapper{arg};
+}
+
+
+template <typename T>
+inline constexpr auto struct_to_tuple() {
+    return object_tuple_view_helper<T, members_count_v<T>>::tuple_view();
+}
+
+template <typename _Ty>
+inline constexpr std::array<std::string_view, members_count_v<_Ty>>
+get_member_names() {
+    constexpr size_t member_count = members_count<_Ty>();
+    using T = std::remove_cvref_t<_Ty>;
+    std::array<std::string_view, member_count> arr;
+    constexpr auto tp = struct_to_tuple<T>();
+    [&]<size_t... Is>(std::index_sequence<Is...>){ //Change
+        ((arr[Is] = get_member_name<wrap(std::get<Is>(tp))>()), ...);
+    }(std::make_index_sequence<member_count>{});
+    return arr;
+}
+
+
+template <typename T>
+constexpr auto object_to_tuple(T&& obj) {
+    using type = std::decay_t<T>;
+    return object_tuple_view_helper<type, members_count_v<type>>::tuple_view(obj);
+}
+
+// Not constexpr: a field attribute naming a missing member fails here
+inline void unknown_field_attribute() {}
+
+template <typename T>
+consteval auto _field_plans() {
+    constexpr auto names = get_member_names<T>();
+    constexpr auto& attrs = field_attributes<T>::value;
+    std::array<field_plan, names.size()> plans{};
+    for (size_t i = 0; i < names.size(); ++i) {
+        plans[i].name = names[i];
+    }
+    [&]<size_t... As>(std::index_sequence<As...>) {
+        [[maybe_unused]] auto apply = [&](const auto& attr, size_t self) {
+            size_t i = 0;
+            while (i < names.size() && names[i] != attr.field) ++i;
+            if (i == names.size()) unknown_field_attribute();
+            else attr.apply(plans[i], self);
+        };
+        (apply(std::get<As>(attrs), As), ...);
+    }(std::make_index_sequence<std::tuple_size_v<std::remove_cvref_t<decltype(attrs)>>>{});
+    return plans;
+}
+
+template <typename T>
+inline constexpr auto field_plans_v = _field_plans<T>();
+
+// Whether any member before index I is printed, for separator placement
+template <typename T, size_t I>
+consteval bool _field_printed_before() {
+    for (size_t i = 0; i < I; ++i) {
+        if (!field_plans_v<T>[i].skip) return true;
+    }
+    return false;
+}
+
+//---members_name---end
+
+/////////////////////// AGGREGATE TYPE /////////////////////////////////////
+
+
+// Open-addressing set of visited pointees for deep pointer printing. The
+// first slots live inline, so small graphs never allocate.
+template <typename Alloc>
+class address_set {
+    static constexpr size_t inline_capacity = 32;
+
+    const void* inline_[inline_capacity] = {};
+    std::vector<const void*, typename std::allocator_traits<Alloc>::template rebind_alloc<const void*>> heap_;
+    const void** slots_ = inline_;
+    size_t capacity_ = inline_capacity;
+    size_t size_ = 0;
+
+    static size_t slot_of(const void* p, size_t capacity) {
+        auto h = reinterpret_cast<std::uintptr_t>(p) * 0x9E3779B97F4A7C15ull;
+        return static_cast<size_t>(h >> 32) & (capacity - 1);
+    }
+
+    void grow() {
+        decltype(heap_) bigger(capacity_ * 2, nullptr, heap_.get_allocator());
+        for (size_t i = 0; i < capacity_; ++i) {
+            if (slots_[i]) {
+                size_t j = slot_of(slots_[i], bigger.size());
+                while (bigger[j]) j = (j + 1) & (bigger.size() - 1);
+                bigger[j] = slots_[i];
+            }
+        }
+        heap_.swap(bigger);
+        slots_ = heap_.data();
+        capacity_ = heap_.size();
+    }
+
+public:
+    explicit address_set(const Alloc& alloc) : heap_(alloc) {}
+    address_set(const address_set&) = delete;
+    address_set& operator=(const address_set&) = delete;
+
+    // Returns false if p was already in the set
+    bool insert(const void* p) {
+        if (2 * (size_ + 1) > capacity_) {
+            grow();
+        }
+        size_t i = slot_of(p, capacity_);
+        while (slots_[i]) {
+            if (slots_[i] == p) return false;
+            i = (i + 1) & (capacity_ - 1);
+        }
+        slots_[i] = p;
+        ++size_;
+        return true;
+    }
+};
+
+template <typename Alloc>
+struct print_context {
+    using allocator_type = Alloc;
+    const print_options& opts;
+    Alloc alloc;
+    address_set<Alloc>* visited = nullptr; // set in deep pointer mode
+    const format_spec* spec = nullptr;     // innermost ju::fmt spec
+};
+
+template <typename CharT, typename Alloc>
+using temp_string = std::basic_string<CharT, std::char_traits<CharT>,
+                                      typename std::allocator_traits<Alloc>::template rebind_alloc<CharT>>;
+
+// Appends to a std::basic_string, or to any string type such as a temp_string
+template <typename CharT, typename String = std::basic_string<CharT>>
+struct string_policy {
+    static_assert(std::same_as<typename String::value_type, CharT>);
+    using char_type = CharT;
+    String* str;
+    void write(std::basic_string_view<CharT> sv) { str->append(sv); }
+};
+
+// Write narrow text, widening into a context-allocated temporary if needed
+template <PrintPolicy Policy, typename Alloc>
+void _write_text(Policy& policy, std::string_view text, print_context<Alloc>& ctx) {
+    using CharT = typename Policy::char_type;
+    if constexpr (std::same_as<CharT, char>) {
+        policy.write(text);
+    } else {
+        policy.write(temp_string<CharT, Alloc>(text.begin(), text.end(), ctx.alloc));
+    }
+}
+
+// View over any string-like object, in its own character type
+template <typename Str>
+auto _source_view(const Str& str) {
+    if constexpr (std::is_pointer_v<Str>) {
+        return std::basic_string_view(static_cast<const std::remove_cv_t<std::remove_pointer_t<Str>>*>(str));
+    } else if constexpr (std::is_array_v<Str>) {
+        return std::basic_string_view(static_cast<const std::remove_cv_t<std::remove_extent_t<Str>>*>(str));
+    } else {
+        return std::basic_string_view(std::data(str), std::size(str));
+    }
+}
+
+// Write any string-like object, at most max_len characters; other character
+// types are converted unit by unit
+template <PrintPolicy Policy, typename Str, typename Alloc>
+void _write_string(Policy& policy, const Str& str, print_context<Alloc>& ctx, size_t max_len = size_t(-1)) {
+    using CharT = typename Policy::char_type;
+    auto view = _source_view(str);
+    view = view.substr(0, std::min(view.size(), max_len));
+    if constexpr (std::same_as<typename decltype(view)::value_type, CharT>) {
+        policy.write(view);
+    } else if constexpr (std::same_as<typename decltype(view)::value_type, char>) {
+        _write_text(policy, view, ctx);
+    } else {
+        temp_string<CharT, Alloc> converted(ctx.alloc);
+        converted.reserve(view.size());
+        for (auto c : view) {
+            converted.push_back(static_cast<CharT>(c));
+        }
+        policy.write(converted);
+    }
+}
+
+// Write narrow characters formatted into a stack buffer
+template <PrintPolicy Policy>
+void _write_chars(Policy& policy, const char* first, const char* last) {
+    using CharT = typename Policy::char_type;
+    if constexpr (std::same_as<CharT, char>) {
+        policy.write(std::string_view(first, last));
+    } else {
+        CharT wide[64];
+        while (first != last) {
+            size_t n = std::min<size_t>(last - first, std::size(wide));
+            std::copy(first, first + n, wide);
+            policy.write(std::basic_string_view<CharT>(wide, n));
+            first += n;
+        }
+    }
+}
+
+template <PrintPolicy Policy>
+void _write_fill(Policy& policy, char fill, size_t count) {
+    using CharT = typename Policy::char_type;
+    CharT run[16];
+    std::fill(std::begin(run), std::end(run), CharT(fill));
+    while (count != 0) {
+        size_t n = std::min(count, std::size(run));
+        policy.write(std::basic_string_view<CharT>(run, n));
+        count -= n;
+    }
+}
+
+// Terminal columns of one code point: combining marks and zero-width
+// characters take none, East Asian wide characters and emoji take two
+constexpr size_t _code_point_width(char32_t c) {
+    if ((c >= 0x0300 && c <= 0x036F) || (c >= 0x200B && c <= 0x200F) || (c >= 0xFE00 && c <= 0xFE0F)) return 0;
+    if ((c >= 0x1100 && c <= 0x115F) || (c >= 0x2E80 && c <= 0xA4CF && c != 0x303F) ||
+        (c >= 0xAC00 && c <= 0xD7A3) || (c >= 0xF900 && c <= 0xFAFF) || (c >= 0xFE30 && c <= 0xFE4F) ||
+        (c >= 0xFF00 && c <= 0xFF60) || (c >= 0xFFE0 && c <= 0xFFE6) || (c >= 0x1F300 && c <= 0x1F64F) ||
+        (c >= 0x1F900 && c <= 0x1F9FF) || (c >= 0x20000 && c <= 0x3FFFD)) {
+        return 2;
+    }
+    return 1;
+}
+
+// Terminal columns of text, decoded as by _decode
+template <typename CharT>
+size_t _display_width(std::basic_string_view<CharT> text) {
+    if (_is_ascii(text)) return text.size();
+    size_t width = 0;
+    for (size_t i = 0; i < text.size();) {
+        auto [c, n] = _decode(text, i);
+        width += _code_point_width(c);
+        i += n;
+    }
+    return width;
+}
+
+// Pad content of the given length to spec.width
+template <PrintPolicy Policy, typename Content>
+void _write_padded(Policy& policy, const format_spec& spec, size_t length, char default_align, Content&& content) {
+    size_t pad = spec.width > length ? spec.width - length : 0;
+    char align = spec.align ? spec.align : default_align;
+    size_t before = align == '>' ? pad : align == '^' ? pad / 2 : 0;
+    _write_fill(policy, spec.fill, before);
+    content();
+    _write_fill(policy, spec.fill, pad - before);
+}
+
+template <typename T>
+concept character = _concept::stringlike::CharacterType<T> ||
+                    std::same_as<T, signed char> || std::same_as<T, unsigned char>;
+
+// Arithmetic and pointer formatting without streams; the text matches what
+// the default ostream formatting produces.
+template <PrintPolicy Policy, typename T>
+void _write_number(Policy& policy, T val) {
+    using CharT = typename Policy::char_type;
+    char buf[64];
+    char* last = buf;
+    if constexpr (character<T>) {
+        CharT ch = static_cast<CharT>(val);
+        policy.write(std::basic_string_view<CharT>(&ch, 1));
+        return;
+    } else if constexpr (std::same_as<T, bool>) {
+        *last++ = val ? '1' : '0';
+    } else if constexpr (std::is_pointer_v<T>) {
+        auto addr = reinterpret_cast<std::uintptr_t>(reinterpret_cast<const void*>(val));
+        if (addr != 0) {
+            *last++ = '0';
+            *last++ = 'x';
+        }
+        last = std::to_chars(last, std::end(buf), addr, 16).ptr;
+    } else if constexpr (std::is_floating_point_v<T>) {
+        last = std::to_chars(buf, std::end(buf), val, std::chars_format::general, 6).ptr;
+    } else {
+        last = std::to_chars(buf, std::end(buf), val).ptr;
+    }
+    _write_chars(policy, buf, last);
+}
+
+// Number formatting under a format_spec, still through to_chars
+template <PrintPolicy Policy, typename T>
+void _write_number(Policy& policy, T val, const format_spec& spec) {
+    using CharT = typename Policy::char_type;
+    char head[4];         // sign and base prefix
+    size_t head_len = 0;
+    char stack_buf[512];  // digits
+    std::unique_ptr<char[]> heap_buf; // fixed notation of a huge long double
+    char* buf = stack_buf;
+    char* last = buf;
+    bool upper = spec.type >= 'A' && spec.type <= 'Z';
+    auto put_sign = [&](bool negative) {
+        if (negative) head[head_len++] = '-';
+        else if (spec.sign != '-') head[head_len++] = spec.sign;
+    };
+
+    if constexpr (character<T>) {
+        if (spec.type == 0 || spec.type == 'c') {
+            CharT ch = static_cast<CharT>(val);
+            _write_padded(policy, spec, 1, '<', [&] { policy.write(std::basic_string_view<CharT>(&ch, 1)); });
+            return;
+        }
+        using code_type = std::conditional_t<std::is_signed_v<T>, long long, unsigned long long>;
+        _write_number(policy, static_cast<code_type>(val), spec);
+        return;
+    } else if constexpr (std::same_as<T, bool>) {
+        if (spec.type == 0 || spec.type == 's') {
+            std::string_view text = val ? "true" : "false";
+            _write_padded(policy, spec, text.size(), '<', [&] { _write_chars(policy, text.data(), text.data() + text.size()); });
+            return;
+        }
+        _write_number(policy, static_cast<unsigned>(val), spec);
+        return;
+    } else if constexpr (std::is_pointer_v<T>) {
+        auto addr = reinterpret_cast<std::uintptr_t>(reinterpret_cast<const void*>(val));
+        head[head_len++] = '0';
+        head[head_len++] = upper ? 'X' : 'x';
+        last = std::to_chars(buf, std::end(stack_buf), addr, 16).ptr;
+    } else if constexpr (std::is_floating_point_v<T>) {
+        put_sign(std::signbit(val));
+        T mag = std::abs(val);
+        int precision = std::min(spec.precision, 100);
+        // The last byte is kept free for the '.' that '#' may insert
+        auto convert = [&](char* first, char* end) {
+            switch (spec.type) {
+            case 'f': case 'F':
+                return std::to_chars(first, end, mag, std::chars_format::fixed, precision < 0 ? 6 : precision);
+            case 'e': case 'E':
+                return std::to_chars(first, end, mag, std::chars_format::scientific, precision < 0 ? 6 : precision);
+            case 'a': case 'A':
+                return precision < 0 ? std::to_chars(first, end, mag, std::chars_format::hex)
+                                     : std::to_chars(first, end, mag, std::chars_format::hex, precision);
+            default:
+                return std::to_chars(first, end, mag, std::chars_format::general, precision < 0 ? 6 : precision);
+            }
+        };
+        auto res = convert(buf, std::end(stack_buf) - 1);
+        // Fixed notation of a large long double runs to thousands of digits
+        for (size_t capacity = 2 * sizeof(stack_buf); res.ec == std::errc::value_too_large; capacity *= 2) {
+            heap_buf.reset(new char[capacity]);
+            buf = heap_buf.get();
+            res = convert(buf, buf + capacity - 1);
+        }
+        last = res.ptr;
+        if (spec.alternate && std::isfinite(mag) && std::find(buf, last, '.') == last) {
+            char* exp = std::find_if(buf, last, [](char c) { return c == 'e' || c == 'p'; });
+            std::copy_backward(exp, last, last + 1);
+            *exp = '.';
+            ++last;
+        }
+    } else {
+        using U = std::make_unsigned_t<T>;
+        U mag = static_cast<U>(val);
+        if constexpr (std::is_signed_v<T>) {
+            if (val < 0) mag = U(0) - mag;
+            put_sign(val < 0);
+        } else {
+            put_sign(false);
+        }
+        int base = 10;
+        switch (spec.type) {
+        case 'x': case 'X': base = 16; break;
+        case 'b': case 'B': base = 2; break;
+        case 'o': base = 8; break;
+        case 'c': {
+            CharT ch = static_cast<CharT>(val);
+            _write_padded(policy, spec, 1, '<', [&] { policy.write(std::basic_string_view<CharT>(&ch, 1)); });
+            return;
+        }
+        default: break;
+        }
+        if (spec.alternate && base != 10) {
+            head[head_len++] = '0';
+            if (base == 16) head[head_len++] = upper ? 'X' : 'x';
+            if (base == 2) head[head_len++] = upper ? 'B' : 'b';
+        }
+        last = std::to_chars(buf, std::end(stack_buf), mag, base).ptr;
+        if (base == 8 && spec.alternate && mag == 0) --head_len; // "0", not "00"
+    }
+    if (upper) {
+        std::transform(buf, last, buf, [](char c) { return c >= 'a' && c <= 'z' ? char(c - 'a' + 'A') : c; });
+    }
+
+    size_t length = head_len + (last - buf);
+    if (spec.zero_pad && !spec.align) {
+        _write_chars(policy, head, head + head_len);
+        _write_fill(policy, '0', spec.width > length ? spec.width - length : 0);
+        _write_chars(policy, buf, last);
+    } else {
+        _write_padded(policy, spec, length, '>', [&] {
+            _write_chars(policy, head, head + head_len);
+            _write_chars(policy, buf, last);
+        });
+    }
+}
+
+// Spec for a number: the enclosing ju::fmt, else the printer default for its kind
+template <typename T, typename Alloc>
+const format_spec* _number_spec(const print_context<Alloc>& ctx) {
+    if (ctx.spec) {
+        return ctx.spec;
+    }
+    if constexpr (std::is_floating_point_v<T>) {
+        return ctx.opts.float_format ? &*ctx.opts.float_format : nullptr;
+    } else if constexpr (std::is_integral_v<T> && !std::same_as<T, bool> && !character<T>) {
+        return ctx.opts.integer_format ? &*ctx.opts.integer_format : nullptr;
+    } else {
+        return nullptr;
+    }
+}
+
+// Structural hooks. Layout-aware policies get the group boundaries and
+// separators, every other policy just receives the literal.
+template <typename Policy>
+concept LayoutPolicy = requires(Policy& p, std::basic_string_view<typename Policy::char_type> sv, size_t depth) {
+    p.open_group(sv, depth);
+    p.separator(sv, depth);
+    p.close_group(sv, depth);
+};
+
+template <PrintPolicy Policy>
+void _open_group(Policy& policy, std::basic_string_view<typename Policy::char_type> lit, size_t depth) {
+    if constexpr (LayoutPolicy<Policy>) {
+        policy.open_group(lit, depth);
+    } else {
+        policy.write(lit);
+    }
+}
+
+template <PrintPolicy Policy>
+void _separator(Policy& policy, size_t depth) {
+    if constexpr (LayoutPolicy<Policy>) {
+        policy.separator(literals<typename Policy::char_type>::comma_space, depth);
+    } else {
+        policy.write(literals<typename Policy::char_type>::comma_space);
+    }
+}
+
+template <PrintPolicy Policy>
+void _close_group(Policy& policy, std::basic_string_view<typename Policy::char_type> lit, size_t depth) {
+    if constexpr (LayoutPolicy<Policy>) {
+        policy.close_group(lit, depth);
+    } else {
+        policy.write(lit);
+    }
+}
+
+// Pretty-mode document. Recording appends the single-line rendering to text_
+// and marks where groups open/close and where separators sit; a group's flat
+// width is known as soon as it closes. emit() then makes one pass: a group
+// that fits in the rest of the line is copied flat, otherwise it is broken
+// with one element per line indented by depth. Both passes are linear.
+template <typename CharT, typename Alloc>
+class layout_policy {
+    template <typename T>
+    using alloc_of = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+    using string_view_type = std::basic_string_view<CharT>;
+    using Lit = literals<CharT>;
+
+    enum class mark : unsigned char { open, separator, close };
+    struct token {
+        mark kind;
+        size_t pos;    // offset of the literal in text_
+        size_t len;    // length of the literal
+        size_t depth;
+        size_t width;  // open: single-line width of the whole group
+        size_t match;  // open: index of the matching close token
+    };
+
+    temp_string<CharT, Alloc> text_;
+    std::vector<token, alloc_of<token>> tokens_;
+    std::vector<size_t, alloc_of<size_t>> open_;
+
+    void push(mark kind, string_view_type lit, size_t depth) {
+        tokens_.push_back({kind, text_.size(), lit.size(), depth, 0, 0});
+        text_.append(lit);
+    }
+
+    static string_view_type trimmed(string_view_type lit) {
+        auto first = lit.find_first_not_of(CharT(' '));
+        auto last = lit.find_last_not_of(CharT(' '));
+        return first == string_view_type::npos ? string_view_type{} : lit.substr(first, last - first + 1);
+    }
+
+public:
+    using char_type = CharT;
+
+    explicit layout_policy(const Alloc& alloc) : text_(alloc), tokens_(alloc), open_(alloc) {}
+
+    void write(string_view_type sv) { text_.append(sv); }
+
+    void open_group(string_view_type lit, size_t depth) {
+        open_.push_back(tokens_.size());
+        push(mark::open, lit, depth);
+    }
+
+    void separator(string_view_type lit, size_t depth) { push(mark::separator, lit, depth); }
+
+    void close_group(string_view_type lit, size_t depth) {
+        size_t open = open_.back();
+        open_.pop_back();
+        tokens_[open].match = tokens_.size();
+        push(mark::close, lit, depth);
+        tokens_[open].width = text_.size() - tokens_[open].pos;
+    }
+
+    template <PrintPolicy Policy>
+    void emit(Policy& policy, size_t width, size_t indent) const {
+        const string_view_type text = text_;
+        size_t cursor = 0;
+        size_t column = 0;
+        auto copy_to = [&](size_t end) {
+            if (end == cursor) return;
+            auto chunk = text.substr(cursor, end - cursor);
+            policy.write(chunk);
+            auto nl = chunk.rfind(CharT('\n'));
+            column = nl == string_view_type::npos ? column + chunk.size() : chunk.size() - nl - 1;
+            cursor = end;
+        };
+        auto literal = [&](const token& t) {
+            auto lit = trimmed(text.substr(t.pos, t.len));
+            policy.write(lit);
+            column += lit.size();
+            cursor = t.pos + t.len;
+        };
+        auto newline = [&](size_t depth) {
+            policy.write(Lit::newline);
+            column = depth * indent;
+            for (size_t n = column; n != 0;) {
+                size_t step = std::min(n, std::size(Lit::spaces) - 1);
+                policy.write(string_view_type(Lit::spaces, step));
+                n -= step;
+            }
+        };
+
+        for (size_t i = 0; i < tokens_.size(); ++i) {
+            const token& t = tokens_[i];
+            copy_to(t.pos);
+            switch (t.kind) {
+            case mark::open:
+                if (column + t.width <= width || t.match == i + 1) {
+                    copy_to(t.pos + t.width);
+                    i = t.match;
+                } else {
+                    literal(t);
+                    newline(t.depth + 1);
+                }
+                break;
+            case mark::separator:
+                literal(t);
+                newline(t.depth + 1);
+                break;
+            case mark::close:
+                newline(t.depth);
+                literal(t);
+                break;
+            }
+        }
+        copy_to(text.size());
+    }
+};
+
+template <PrintPolicy Policy, typename Obj, typename Alloc>
+void _print_impl(Policy& policy, Obj&& obj, size_t depth, print_context<Alloc>& ctx);
+
+// Sink handed to user formatters: no intermediate string, same context
+template <PrintPolicy Policy, typename Alloc>
+class format_sink {
+public:
+    using char_type = typename Policy::char_type;
+
+    format_sink(Policy& policy, size_t depth, print_context<Alloc>& ctx)
+        : policy_(policy), depth_(depth), ctx_(ctx) {}
+
+    void write(std::basic_string_view<char_type> sv) { policy_.write(sv); }
+
+    // Narrow text for wide printers, e.g. out.write("Vec3(")
+    void write(std::string_view text) requires (!std::same_as<char_type, char>) {
+        _write_text(policy_, text, ctx_);
+    }
+
+    // Print a member as the built-in rules would, one level deeper
+    template <typename T>
+    void print(T&& value) {
+        _print_impl(policy_, std::forward<T>(value), depth_ + 1, ctx_);
+    }
+
+    const print_options& options() const { return ctx_.opts; }
+
+private:
+    Policy& policy_;
+    size_t depth_;
+    print_context<Alloc>& ctx_;
+};
+
+template <typename T, typename Sink>
+concept has_formatter = requires(Sink& sink, const T& value) {
+    formatter<T>{}.format(sink, value);
+};
+
+template <typename T, typename Sink>
+concept has_eprint_format = requires(Sink& sink, const T& value) {
+    eprint_format(sink, value);
+};
+
+// Deep pointer mode: record the pointee, or write a back-reference and
+// return false if it has been printed before.
+template <PrintPolicy Policy, typename T, typename Alloc>
+bool _enter_pointee(Policy& policy, T* ptr, print_context<Alloc>& ctx) {
+    using Lit = literals<typename Policy::char_type>;
+    if (!ctx.opts.deep_pointers || !ctx.visited) {
+        return true;
+    }
+    auto addr = static_cast<const void*>(ptr);
+    if (ctx.visited->insert(addr)) {
+        return true;
+    }
+    policy.write(Lit::cycle_prefix);
+    _write_number(policy, addr);
+    policy.write(Lit::gt);
+    return false;
+}
+
+template <PrintPolicy Policy, typename Ptr, typename Alloc>
+void _print_pointee(Policy& policy, const Ptr& ptr, size_t depth, print_context<Alloc>& ctx) {
+    using Lit = literals<typename Policy::char_type>;
+    if constexpr (requires { *ptr; } && !std::is_void_v<typename Ptr::element_type>) {
+        if (ctx.opts.deep_pointers && ctx.visited) {
+            policy.write(Lit::value_prefix);
+            _print_impl(policy, *ptr, depth + 1, ctx);
+        }
+    }
+}
+
+// Underlying container of queue/stack/priority_queue, read through the
+// protected member c without copying the adaptor.
+template <typename Adaptor>
+const auto& _underlying(const Adaptor& adaptor) {
+    struct access : Adaptor {
+        static const auto& get(const Adaptor& a) { return a.*&access::c; }
+    };
+    return access::get(adaptor);
+}
+
+// '0'/'1' patterns for every byte value, most significant bit first
+inline constexpr auto _bit_patterns = [] {
+    std::array<std::array<char, 8>, 256> table{};
+    for (size_t b = 0; b < 256; ++b) {
+        for (size_t i = 0; i < 8; ++i) {
+            table[b][i] = (b >> (7 - i)) & 1 ? '1' : '0';
+        }
+    }
+    return table;
+}();
+
+// Renders bitset words (least significant word first) a byte at a time,
+// bit N-1 first like operator<<.
+template <PrintPolicy Policy, size_t N, typename Alloc>
+void _print_bitset(Policy& policy, const std::bitset<N>& bits, print_context<Alloc>& ctx) {
+    using CharT = typename Policy::char_type;
+    constexpr size_t word_bits = 64;
+    temp_string<CharT, Alloc> out(N, CharT('0'), ctx.alloc);
+    auto render_word = [&](unsigned long long word, size_t low_bit) {
+        // out[N - 1 - i] holds bit i
+        for (size_t byte = 0; byte * 8 < word_bits && low_bit + byte * 8 < N; ++byte) {
+            const auto& pattern = _bit_patterns[(word >> (byte * 8)) & 0xFF];
+            for (size_t i = 0; i < 8; ++i) {
+                size_t bit = low_bit + byte * 8 + (7 - i);
+                if (bit < N) out[N - 1 - bit] = CharT(pattern[i]);
+            }
+        }
+    };
+    if constexpr (N <= word_bits) {
+        render_word(bits.to_ullong(), 0);
+    } else {
+        // bitset has no word access; gather each word bit by bit, one pass
+        for (size_t low_bit = 0; low_bit < N; low_bit += word_bits) {
+            unsigned long long word = 0;
+            for (size_t i = 0; i < word_bits && low_bit + i < N; ++i) {
+                word |= static_cast<unsigned long long>(bits[low_bit + i]) << i;
+            }
+            render_word(word, low_bit);
+        }
+    }
+    policy.write(out);
+}
+
+// Variant alternatives are dispatched through a table indexed by index()
+template <PrintPolicy Policy, typename Variant, typename Alloc>
+void _print_variant(Policy& policy, const Variant& var, size_t depth, print_context<Alloc>& ctx) {
+    using Lit = literals<typename Policy::char_type>;
+    using fn = void (*)(Policy&, const Variant&, size_t, print_context<Alloc>&);
+    static constexpr auto table = []<size_t... Is>(std::index_sequence<Is...>) {
+        return std::array<fn, sizeof...(Is)>{
+            [](Policy& p, const Variant& v, size_t d, print_context<Alloc>& c) {
+                _print_impl(p, *std::get_if<Is>(&v), d, c);
+            }...
+        };
+    }(std::make_index_sequence<std::variant_size_v<Variant>>{});
+    if (var.valueless_by_exception()) {
+        policy.write(Lit::none);
+    } else {
+        table[var.index()](policy, var, depth, ctx);
+    }
+}
+
+// std::any can only be inspected by guessing; common value types are printed,
+// anything else as <any: type>.
+template <PrintPolicy Policy, typename Alloc>
+void _print_any(Policy& policy, const std::any& value, size_t depth, print_context<Alloc>& ctx) {
+    using Lit = literals<typename Policy::char_type>;
+    if (!value.has_value()) {
+        policy.write(Lit::none);
+        return;
+    }
+    auto try_print = [&]<typename... Ts>() {
+        return ([&] {
+            if (auto* v = std::any_cast<Ts>(&value)) {
+                _print_impl(policy, *v, depth, ctx);
+                return true;
+            }
+            return false;
+        }() || ...);
+    };
+    if (try_print.template operator()<int, long, long long, unsigned, unsigned long, unsigned long long,
+                                      double, float, bool, char, std::string, std::string_view, const char*>()) {
+        return;
+    }
+    policy.write(Lit::any_prefix);
+#if __has_include(<cxxabi.h>)
+    int status = 0;
+    std::unique_ptr<char, void (*)(void*)> name(
+        abi::__cxa_demangle(value.type().name(), nullptr, nullptr, &status), std::free);
+    _write_text(policy, status == 0 ? name.get() : value.type().name(), ctx);
+#else
+    _write_text(policy, value.type().name(), ctx);
+#endif
+    policy.write(Lit::gt);
+}
+
+template <typename T>
+concept _less_comparable = requires(const T& a, const T& b) {
+    { a < b } -> std::convertible_to<bool>;
+};
+
+// Radix sort key: the integer with its sign bit flipped, so unsigned order
+// matches the key's order
+template <std::integral K>
+uint64_t _radix_key(K key) {
+    auto bits = static_cast<uint64_t>(static_cast<std::make_unsigned_t<K>>(key));
+    if constexpr (std::is_signed_v<K>) {
+        bits ^= uint64_t(1) << (sizeof(K) * 8 - 1);
+    }
+    return bits;
+}
+
+// Stable LSD radix sort of (key, element) pairs, one pass per key byte;
+// bytes that are equal in every key are skipped
+template <typename Entry>
+void _radix_sort(Entry* entries, Entry* scratch, size_t n, size_t key_bytes) {
+    for (size_t byte = 0; byte < key_bytes; ++byte) {
+        size_t shift = byte * 8;
+        size_t counts[257] = {};
+        for (size_t i = 0; i < n; ++i) {
+            ++counts[((entries[i].key >> shift) & 0xff) + 1];
+        }
+        if (counts[((entries[0].key >> shift) & 0xff) + 1] == n) {
+            continue;
+        }
+        for (size_t d = 1; d < 257; ++d) {
+            counts[d] += counts[d - 1];
+        }
+        for (size_t i = 0; i < n; ++i) {
+            scratch[counts[(entries[i].key >> shift) & 0xff]++] = entries[i];
+        }
+        std::copy(scratch, scratch + n, entries);
+    }
+}
+
+// Containers other than unordered ones with ordered keys keep their order
+template <typename C, typename Alloc, typename F>
+bool _for_each_sorted(const C&, print_context<Alloc>&, F&&) {
+    return false;
+}
+
+// With print_options::sort_unordered, calls f on the elements of an
+// unordered container in key order and returns true. Only pointers to the
+// elements are sorted: in a stack buffer for small containers, by radix
+// sort for integral keys. Returns false when the plain iteration order
+// should be used.
+template <typename C, typename Alloc, typename F>
+    requires _concept::std_t::is_unordered<C> && _less_comparable<typename C::key_type>
+bool _for_each_sorted(const C& c, print_context<Alloc>& ctx, F&& f) {
+    using value_type = typename C::value_type;
+    using key_type = typename C::key_type;
+    if (!ctx.opts.sort_unordered) {
+        return false;
+    }
+    auto key_of = [](const value_type* v) -> const key_type& {
+        if constexpr (_concept::std_t::is_map<C>) {
+            return v->first;
+        } else {
+            return *v;
+        }
+    };
+    // Equal keys of a multimap are ordered by value when possible
+    constexpr bool by_value = [] {
+        if constexpr (_concept::std_t::is_map<C> && _concept::std_t::is_multi<C>) {
+            return _less_comparable<typename C::mapped_type>;
+        } else {
+            return false;
+        }
+    }();
+    // Floating keys use a total order (-NaN first, NaN last, -0 < +0):
+    // operator< is not a strict weak order once NaN is present
+    auto key_less = [](const key_type& a, const key_type& b) {
+        if constexpr (std::is_floating_point_v<key_type>) {
+            return std::strong_order(a, b) < 0;
+        } else {
+            return bool(a < b);
+        }
+    };
+    auto less = [&](const value_type* a, const value_type* b) {
+        if constexpr (by_value) {
+            if (key_less(a->first, b->first)) return true;
+            if (key_less(b->first, a->first)) return false;
+            return bool(a->second < b->second);
+        } else {
+            return key_less(key_of(a), key_of(b));
+        }
+    };
+    using traits = std::allocator_traits<Alloc>;
+    constexpr size_t inline_count = 64;
+    const value_type* inline_buffer[inline_count];
+    std::vector<const value_type*, typename traits::template rebind_alloc<const value_type*>> heap_buffer(ctx.alloc);
+    const value_type** order = inline_buffer;
+    size_t n = c.size();
+
+    if constexpr (std::integral<key_type> && !std::same_as<key_type, bool> && !by_value) {
+        if (n > inline_count) {
+            struct entry {
+                uint64_t key;
+                const value_type* element;
+            };
+            std::vector<entry, typename traits::template rebind_alloc<entry>> entries(ctx.alloc);
+            entries.reserve(n * 2);
+            for (const auto& v : c) {
+                entries.push_back({_radix_key(key_of(&v)), &v});
+            }
+            entries.resize(n * 2);
+            _radix_sort(entries.data(), entries.data() + n, n, sizeof(key_type));
+            for (size_t i = 0; i < n; ++i) {
+                f(*entries[i].element);
+            }
+            return true;
+        }
+    }
+    if (n > inline_count) {
+        heap_buffer.resize(n);
+        order = heap_buffer.data();
+    }
+    size_t i = 0;
+    for (const auto& v : c) {
+        order[i++] = &v;
+    }
+    if constexpr (_concept::std_t::is_multi<C>) {
+        // Equal keys keep their relative order when values cannot break ties
+        std::stable_sort(order, order + n, less);
+    } else {
+        std::sort(order, order + n, less);
+    }
+    for (i = 0; i < n; ++i) {
+        f(*order[i]);
+    }
+    return true;
+}
+
+// Helper threads shared by every parallel print; they start on first use
+// and stay parked between calls. run(parts, f) calls f(0) .. f(parts - 1)
+// and returns when all have finished. The caller works through unclaimed
+// parts itself, so nested runs make progress even when every helper is busy.
+// The first exception is rethrown in the caller, and the parts not yet
+// started are skipped.
+class worker_pool {
+public:
+    static worker_pool& shared() {
+        static worker_pool pool;
+        return pool;
+    }
+
+    ~worker_pool() {
+        {
+            std::lock_guard lock(mutex_);
+            stop_ = true;
+        }
+        work_.notify_all();
+        for (auto& t : threads_) t.join();
+    }
+
+    template <typename F>
+    void run(size_t parts, F&& f) {
+        using Fn = std::remove_reference_t<F>;
+        job j{[](void* fn, size_t i) { (*static_cast<Fn*>(fn))(i); }, &f, parts};
+        std::unique_lock lock(mutex_);
+        while (threads_.size() + 1 < parts) {
+            threads_.emplace_back([this] { serve(); });
+        }
+        queue_.push_back(&j);
+        work_.notify_all();
+        while (j.next < j.parts) {
+            execute(j, lock);
+        }
+        finished_.wait(lock, [&] { return j.done == j.parts; });
+        lock.unlock();
+        if (j.error) std::rethrow_exception(j.error);
+    }
+
+private:
+    struct job {
+        void (*call)(void*, size_t);
+        void* fn;
+        size_t parts;
+        size_t next = 0; // guarded by mutex_, as are done and error
+        size_t done = 0;
+        std::exception_ptr error{};
+    };
+
+    worker_pool() = default;
+
+    // Claims and runs the next part of j; called and returns with the lock held
+    void execute(job& j, std::unique_lock<std::mutex>& lock) {
+        size_t i = j.next++;
+        if (j.next == j.parts) {
+            queue_.erase(std::find(queue_.begin(), queue_.end(), &j));
+        }
+        bool failed = j.error != nullptr;
+        lock.unlock();
+        std::exception_ptr error;
+        if (!failed) {
+            try {
+                j.call(j.fn, i);
+            } catch (...) {
+                error = std::current_exception();
+            }
+        }
+        lock.lock();
+        if (error && !j.error) j.error = error;
+        if (++j.done == j.parts) finished_.notify_all();
+    }
+
+    void serve() {
+        std::unique_lock lock(mutex_);
+        for (;;) {
+            work_.wait(lock, [&] { return stop_ || !queue_.empty(); });
+            if (stop_) return;
+            execute(*queue_.front(), lock);
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable work_;     // a job was queued, or shutdown
+    std::condition_variable finished_; // some job ran its last part
+    std::deque<job*> queue_;           // jobs with unclaimed parts
+    std::vector<std::thread> threads_;
+    bool stop_ = false;
+};
+
+inline size_t _parallel_workers(const print_options& opts, size_t size) {
+    // Deep pointer mode shares the visited set across elements
+    if (opts.parallel_threshold == 0 || size < opts.parallel_threshold || opts.deep_pointers) {
+        return 1;
+    }
+    size_t workers = opts.parallel_threads != 0 ? opts.parallel_threads : std::thread::hardware_concurrency();
+    return std::min(workers, size);
+}
+
+// Chunk buffers outlive the worker that fills them. The arena is per thread
+// and rewound by the worker's scope, so with it they fall back to the heap.
+template <typename CharT, typename Alloc>
+struct _chunk_buffer {
+    using type = temp_string<CharT, Alloc>;
+};
+
+template <typename CharT, typename T>
+struct _chunk_buffer<CharT, arena_allocator<T>> {
+    using type = std::basic_string<CharT>;
+};
+
+// Each worker formats a contiguous chunk into a private buffer, the buffers are
+// then written in order, so the output is identical to the serial branch.
+template <PrintPolicy Policy, typename Range, typename Alloc>
+void _print_range_parallel(Policy& policy, Range& range, size_t depth, print_context<Alloc>& ctx, size_t workers) {
+    using CharT = typename Policy::char_type;
+    using Lit = literals<CharT>;
+    using buffer_type = typename _chunk_buffer<CharT, Alloc>::type;
+    using buffer_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<buffer_type>;
+
+    const size_t size = std::ranges::size(range);
+    const size_t chunk = (size + workers - 1) / workers;
+    std::vector<buffer_type, buffer_alloc> buffers{buffer_alloc(ctx.alloc)};
+    buffers.reserve(workers);
+    for (size_t w = 0; w < workers; ++w) {
+        if constexpr (std::same_as<buffer_type, temp_string<CharT, Alloc>>) {
+            buffers.emplace_back(ctx.alloc);
+        } else {
+            buffers.emplace_back();
+        }
+    }
+    print_options chunk_opts = ctx.opts;
+    chunk_opts.parallel_threshold = 0; // nested ranges stay on the worker
+
+    auto format_chunk = [&](size_t w) {
+        // Temporaries come from the worker's own arena
+        alloc_scope<Alloc> scope;
+        print_context<Alloc> chunk_ctx{chunk_opts, ctx.alloc};
+        chunk_ctx.spec = ctx.spec;
+        string_policy<CharT, buffer_type> sp{&buffers[w]};
+        auto it = std::ranges::begin(range);
+        const size_t last = std::min(size, (w + 1) * chunk);
+        for (size_t i = w * chunk; i < last; ++i) {
+            if (i != 0) sp.write(Lit::comma_space);
+            _print_impl(sp, it[i], depth + 1, chunk_ctx);
+        }
+    };
+    // An element that throws fails the whole range before anything is written
+    worker_pool::shared().run(workers, format_chunk);
+
+    policy.write(Lit::open_bracket);
+    for (auto& buffer : buffers) {
+        policy.write(buffer);
+    }
+    policy.write(Lit::close_bracket);
+}
+
+// First n elements of a range or string, then an elision marker
+template <PrintPolicy Policy, typename Obj, typename Alloc>
+void _print_truncated(Policy& policy, const Obj& obj, size_t n, size_t depth, print_context<Alloc>& ctx) {
+    using Lit = literals<typename Policy::char_type>;
+    if constexpr (_concept::std_t::is_fixed_string<Obj>::value) {
+        _print_truncated(policy, obj.view(), n, depth, ctx);
+    } else if constexpr (_concept::stringlike::string_like<Obj>) {
+        size_t size = _source_view(obj).size();
+        policy.write(Lit::quote);
+        _write_string(policy, obj, ctx, n);
+        if (size > n) _write_text(policy, "...", ctx);
+        policy.write(Lit::quote);
+    } else if constexpr (std::ranges::input_range<const Obj>) {
+        _open_group(policy, Lit::open_bracket, depth);
+        size_t i = 0;
+        for (auto&& elem : obj) {
+            if (i == n) {
+                _separator(policy, depth);
+                _write_text(policy, "...", ctx);
+                if constexpr (std::ranges::sized_range<const Obj>) {
+                    char buf[32];
+                    auto res = std::to_chars(buf, std::end(buf), std::ranges::size(obj) - n);
+                    _write_text(policy, " (+", ctx);
+                    _write_text(policy, std::string_view(buf, res.ptr), ctx);
+                    _write_text(policy, ")", ctx);
+                }
+                break;
+            }
+            if (i++ != 0) _separator(policy, depth);
+            _print_impl(policy, elem, depth + 1, ctx);
+        }
+        _close_group(policy, Lit::close_bracket, depth);
+    } else {
+        _print_impl(policy, obj, depth, ctx);
+    }
+}
+
+// One reflected member, as planned by its field attributes
+template <typename T, size_t I, PrintPolicy Policy, typename Member, typename Alloc>
+void _print_field(Policy& policy, const Member& member, size_t depth, print_context<Alloc>& ctx) {
+    constexpr const field_plan& plan = field_plans_v<T>[I];
+    if constexpr (plan.redact) {
+        _write_text(policy, "<redacted>", ctx);
+    } else if constexpr (plan.formatter != size_t(-1)) {
+        using attr_type = std::remove_cvref_t<decltype(std::get<plan.formatter>(field_attributes<T>::value))>;
+        format_sink<Policy, Alloc> sink(policy, depth, ctx);
+        typename attr_type::formatter_type{}.format(sink, member);
+    } else if constexpr (plan.spec.has_value()) {
+        static constexpr format_spec spec = *plan.spec;
+        const format_spec* outer = ctx.spec;
+        ctx.spec = &spec;
+        if constexpr (plan.truncate != size_t(-1)) {
+            _print_truncated(policy, member, plan.truncate, depth, ctx);
+        } else {
+            _print_impl(policy, member, depth, ctx);
+        }
+        ctx.spec = outer;
+    } else if constexpr (plan.truncate != size_t(-1)) {
+        _print_truncated(policy, member, plan.truncate, depth, ctx);
+    } else {
+        _print_impl(policy, member, depth, ctx);
+    }
+}
+
+/////////////////////// HEXDUMP ////////////////////////////////////////////
+// Writes two lowercase hex digits per input byte
+inline void _hex_encode(const unsigned char* in, size_t n, char* out) {
+    constexpr char digits[] = "0123456789abcdef";
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i low_mask = _mm_set1_epi8(0x0f);
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i zero_char = _mm_set1_epi8('0');
+    const __m128i letter_gap = _mm_set1_epi8('a' - '0' - 10);
+    auto to_ascii = [&](__m128i nibbles) {
+        __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(nibbles, nine), letter_gap);
+        return _mm_add_epi8(_mm_add_epi8(nibbles, zero_char), letters);
+    };
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i hi = to_ascii(_mm_and_si128(_mm_srli_epi16(v, 4), low_mask));
+        __m128i lo = to_ascii(_mm_and_si128(v, low_mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+#endif
+    for (; i < n; ++i) {
+        out[2 * i] = digits[in[i] >> 4];
+        out[2 * i + 1] = digits[in[i] & 0x0f];
+    }
+}
+
+template <PrintPolicy Policy, typename Alloc>
+void _print_hexdump(Policy& policy, const unsigned char* data, size_t size, hexdump_style style, print_context<Alloc>& ctx) {
+    if (size == 0) {
+        _write_text(policy, "<0 bytes>", ctx);
+        return;
+    }
+    char buffer[4096];
+    if (style == hexdump_style::compact) {
+        _write_text(policy, "<", ctx);
+        _write_number(policy, size);
+        _write_text(policy, " bytes: ", ctx);
+        for (size_t i = 0; i < size; i += sizeof(buffer) / 2) {
+            size_t n = std::min(sizeof(buffer) / 2, size - i);
+            _hex_encode(data + i, n, buffer);
+            _write_chars(policy, buffer, buffer + 2 * n);
+        }
+        _write_text(policy, ">", ctx);
+        return;
+    }
+
+    // 00000000  0c 00 ff 41 42 43 44 45  46 47 48 49 4a 4b 4c 4d  |...ABCDEFGHIJKLM|
+    constexpr size_t line_size = 79;
+    char* out = buffer;
+    for (size_t offset = 0; offset < size; offset += 16) {
+        if (out + line_size > buffer + sizeof(buffer)) {
+            _write_chars(policy, buffer, out);
+            out = buffer;
+        }
+        if (offset != 0) *out++ = '\n';
+        unsigned char be[4] = {static_cast<unsigned char>(offset >> 24), static_cast<unsigned char>(offset >> 16),
+                               static_cast<unsigned char>(offset >> 8), static_cast<unsigned char>(offset)};
+        _hex_encode(be, 4, out);
+        size_t n = std::min<size_t>(16, size - offset);
+        char hex[32];
+        _hex_encode(data + offset, n, hex);
+        char* cell = out + 8;
+        std::memset(cell, ' ', 52);
+        for (size_t b = 0; b < n; ++b) {
+            std::memcpy(cell + 2 + 3 * b + (b >= 8), hex + 2 * b, 2);
+        }
+        out = cell + 52;
+        *out++ = '|';
+        size_t b = 0;
+#if defined(__SSE2__)
+        if (n == 16) {
+            // Signed compares: bytes from 0x80 up are negative, so not printable
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset));
+            __m128i printable = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(0x1f)),
+                                              _mm_cmplt_epi8(v, _mm_set1_epi8(0x7f)));
+            __m128i dots = _mm_andnot_si128(printable, _mm_set1_epi8('.'));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_or_si128(_mm_and_si128(printable, v), dots));
+            b = 16;
+        }
+#endif
+        for (; b < n; ++b) {
+            unsigned char c = data[offset + b];
+            out[b] = c >= 0x20 && c < 0x7f ? static_cast<char>(c) : '.';
+        }
+        out += n;
+        *out++ = '|';
+    }
+    _write_chars(policy, buffer, out);
+}
+/////////////////////// HEXDUMP ////////////////////////////////////////////
+
+/////////////////////// SUMMARY ////////////////////////////////////////////
+struct summary_stats {
+    size_t count = 0;
+    size_t nan = 0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    double sum = 0;
+
+    void merge(const summary_stats& o) {
+        count += o.count;
+        nan += o.nan;
+        min = std::min(min, o.min);
+        max = std::max(max, o.max);
+        sum += o.sum;
+    }
+};
+
+// First pass: count, NaNs, min, max and sum
+template <typename T>
+summary_stats _summary_scan(const T* data, size_t n) {
+    summary_stats st;
+    st.count = n;
+    size_t i = 0;
+#if defined(__AVX2__)
+    if constexpr (std::same_as<T, double> || std::same_as<T, float>) {
+        const __m256d inf = _mm256_set1_pd(std::numeric_limits<double>::infinity());
+        const __m256d ninf = _mm256_set1_pd(-std::numeric_limits<double>::infinity());
+        const __m256d zero = _mm256_setzero_pd();
+        __m256d vmin = inf, vmax = ninf, vsum = zero;
+        size_t nan = 0;
+        auto step = [&](__m256d v) {
+            __m256d is_nan = _mm256_cmp_pd(v, v, _CMP_UNORD_Q);
+            nan += std::popcount(static_cast<unsigned>(_mm256_movemask_pd(is_nan)));
+            vmin = _mm256_min_pd(vmin, _mm256_blendv_pd(v, inf, is_nan));
+            vmax = _mm256_max_pd(vmax, _mm256_blendv_pd(v, ninf, is_nan));
+            vsum = _mm256_add_pd(vsum, _mm256_blendv_pd(v, zero, is_nan));
+        };
+        if constexpr (std::same_as<T, double>) {
+            for (; i + 4 <= n; i += 4) step(_mm256_loadu_pd(data + i));
+        } else {
+            for (; i + 8 <= n; i += 8) {
+                __m256 v = _mm256_loadu_ps(data + i);
+                step(_mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+                step(_mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+            }
+        }
+        alignas(32) double lanes_min[4], lanes_max[4], lanes_sum[4];
+        _mm256_store_pd(lanes_min, vmin);
+        _mm256_store_pd(lanes_max, vmax);
+        _mm256_store_pd(lanes_sum, vsum);
+        for (int l = 0; l < 4; ++l) {
+            st.min = std::min(st.min, lanes_min[l]);
+            st.max = std::max(st.max, lanes_max[l]);
+            st.sum += lanes_sum[l];
+        }
+        st.nan = nan;
+    }
+#endif
+    for (; i < n; ++i) {
+        double x = static_cast<double>(data[i]);
+        if (x != x) {
+            ++st.nan;
+            continue;
+        }
+        st.min = std::min(st.min, x);
+        st.max = std::max(st.max, x);
+        st.sum += x;
+    }
+    return st;
+}
+
+// Second pass: fine histogram for quantiles and the centred sum of squares
+struct summary_histogram {
+    static constexpr size_t bins = 1024;
+    std::array<size_t, bins> counts{};
+    double squares = 0;
+
+    void merge(const summary_histogram& o) {
+        for (size_t b = 0; b < bins; ++b) counts[b] += o.counts[b];
+        squares += o.squares;
+    }
+};
+
+template <typename T>
+void _summary_bin(const T* data, size_t n, double min, double scale, double mean, summary_histogram& h) {
+    for (size_t i = 0; i < n; ++i) {
+        double x = static_cast<double>(data[i]);
+        if (x != x) continue;
+        double d = x - mean;
+        h.squares += d * d;
+        auto b = static_cast<size_t>((x - min) * scale);
+        ++h.counts[std::min(b, summary_histogram::bins - 1)];
+    }
+}
+
+// Runs f(first, size, worker) over contiguous slices, in parallel when the
+// options allow, and returns the per-worker results
+template <typename Result, typename F>
+std::vector<Result> _summary_slices(size_t n, size_t workers, F&& f) {
+    std::vector<Result> results(workers);
+    size_t per = (n + workers - 1) / workers;
+    auto run = [&](size_t w) {
+        size_t first = std::min(n, w * per);
+        f(first, std::min(n, first + per) - first, results[w]);
+    };
+    worker_pool::shared().run(workers, run);
+    return results;
+}
+
+template <PrintPolicy Policy, typename Range, typename Alloc>
+void _print_summary(Policy& policy, const Range& range, print_context<Alloc>& ctx) {
+    using T = std::remove_cvref_t<std::ranges::range_value_t<Range>>;
+    static_assert(std::is_arithmetic_v<T>, "ju::summary needs a range of numbers");
+    using Lit = literals<typename Policy::char_type>;
+
+    // Non-contiguous ranges are copied once so both passes see an array
+    std::vector<T, typename std::allocator_traits<Alloc>::template rebind_alloc<T>> copy(ctx.alloc);
+    const T* data;
+    size_t n;
+    if constexpr (std::ranges::contiguous_range<const Range> && std::ranges::sized_range<const Range>) {
+        data = std::ranges::data(range);
+        n = std::ranges::size(range);
+    } else {
+        copy.assign(std::ranges::begin(range), std::ranges::end(range));
+        data = copy.data();
+        n = copy.size();
+    }
+
+    size_t workers = _parallel_workers(ctx.opts, n);
+    summary_stats st;
+    for (const auto& part : _summary_slices<summary_stats>(n, workers, [&](size_t first, size_t size, summary_stats& out) {
+             out = _summary_scan(data + first, size);
+         })) {
+        st.merge(part);
+    }
+
+    auto field = [&](std::string_view name, auto value, bool first = false) {
+        if (!first) policy.write(Lit::comma_space);
+        _write_text(policy, name, ctx);
+        policy.write(Lit::colon_space);
+        _write_number(policy, value);
+    };
+    policy.write(Lit::open_brace);
+    field("count", st.count, true);
+    field("nan", st.nan);
+    size_t valid = st.count - st.nan;
+    if (valid != 0) {
+        double mean = st.sum / valid;
+        field("min", st.min);
+        field("max", st.max);
+        field("mean", mean);
+        double range_width = st.max - st.min;
+        if (std::isfinite(range_width)) {
+            double scale = range_width > 0 ? summary_histogram::bins / range_width : 0;
+            summary_histogram h;
+            for (const auto& part : _summary_slices<summary_histogram>(n, workers, [&](size_t first, size_t size, summary_histogram& out) {
+                     _summary_bin(data + first, size, st.min, scale, mean, out);
+                 })) {
+                h.merge(part);
+            }
+            field("stddev", valid > 1 ? std::sqrt(h.squares / (valid - 1)) : 0.0);
+
+            // Quantiles: the value at a rank is estimated by spreading each
+            // bin's samples evenly over it, neighbouring ranks are blended
+            auto at_rank = [&](size_t rank) {
+                size_t seen = 0;
+                for (size_t b = 0; b < summary_histogram::bins; ++b) {
+                    if (seen + h.counts[b] > rank) {
+                        double within = (rank - seen + 0.5) / h.counts[b];
+                        double x = st.min + (b + within) * (range_width / summary_histogram::bins);
+                        return std::clamp(x, st.min, st.max);
+                    }
+                    seen += h.counts[b];
+                }
+                return st.max;
+            };
+            auto quantile = [&](double q) {
+                double target = q * (valid - 1);
+                auto lower = static_cast<size_t>(target);
+                double lo = at_rank(lower);
+                return lower + 1 < valid ? lo + (target - lower) * (at_rank(lower + 1) - lo) : lo;
+            };
+            field("p1", quantile(0.01));
+            field("p25", quantile(0.25));
+            field("p50", quantile(0.5));
+            field("p75", quantile(0.75));
+            field("p99", quantile(0.99));
+
+            // 32 columns, ten density levels
+            constexpr std::string_view levels = " .:-=+*#%@";
+            constexpr size_t columns = 32;
+            std::array<size_t, columns> coarse{};
+            for (size_t b = 0; b < summary_histogram::bins; ++b) {
+                coarse[b * columns / summary_histogram::bins] += h.counts[b];
+            }
+            size_t peak = *std::max_element(coarse.begin(), coarse.end());
+            char bars[columns];
+            for (size_t c = 0; c < columns; ++c) {
+                bars[c] = levels[coarse[c] == 0 ? 0 : 1 + coarse[c] * (levels.size() - 2) / peak];
+            }
+            policy.write(Lit::comma_space);
+            _write_text(policy, "histogram: |", ctx);
+            _write_text(policy, std::string_view(bars, columns), ctx);
+            _write_text(policy, "|", ctx);
+        }
+    }
+    policy.write(Lit::close_brace);
+}
+/////////////////////// SUMMARY ////////////////////////////////////////////
+
+// Table mode: every cell is formatted once into its column's buffer while
+// the column widths are measured, then the rows are laid out from there.
+// Widths are display columns (see _display_width); only columns holding
+// non-ASCII text are measured per character.
+template <PrintPolicy Policy, typename Range, typename Alloc>
+void _print_table(Policy& policy, const Range& rows, print_context<Alloc>& ctx) {
+    using CharT = typename Policy::char_type;
+    using T = std::remove_cvref_t<std::ranges::range_value_t<Range>>;
+    static_assert(std::is_aggregate_v<T>, "ju::table needs a range of aggregates");
+    using text_type = temp_string<CharT, Alloc>;
+    using offset_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<size_t>;
+    constexpr size_t columns = members_count_v<T>;
+    constexpr size_t last_column = [] {
+        size_t last = 0;
+        for (size_t i = 0; i < columns; ++i) {
+            if (!field_plans_v<T>[i].skip) last = i;
+        }
+        return last;
+    }();
+
+    struct column {
+        text_type text;
+        std::vector<size_t, offset_alloc> ends;
+        size_t width = 0;
+        bool measured = false; // non-ASCII: cell widths are not cell lengths
+        explicit column(const Alloc& alloc) : text(alloc), ends(alloc) {}
+    };
+    auto cols = [&]<size_t... Is>(std::index_sequence<Is...>) {
+        return std::array<column, columns>{((void)Is, column(ctx.alloc))...};
+    }(std::make_index_sequence<columns>{});
+
+    if constexpr (std::ranges::sized_range<const Range>) {
+        for (column& col : cols) col.ends.reserve(std::ranges::size(rows));
+    }
+    size_t count = 0;
+    for (const auto& row : rows) {
+        auto members = object_to_tuple(row);
+        [&]<size_t... Is>(std::index_sequence<Is...>) {
+            auto cell = [&]<size_t I>(std::integral_constant<size_t, I>) {
+                if constexpr (!field_plans_v<T>[I].skip) {
+                    column& col = cols[I];
+                    size_t start = col.text.size();
+                    string_policy<CharT, text_type> out{&col.text};
+                    _print_field<T, I>(out, std::get<I>(members), 1, ctx);
+                    col.ends.push_back(col.text.size());
+                    col.width = std::max(col.width, col.text.size() - start);
+                }
+            };
+            (cell(std::integral_constant<size_t, Is>{}), ...);
+        }(std::make_index_sequence<columns>{});
+        ++count;
+    }
+    for (column& col : cols) {
+        std::basic_string_view<CharT> text(col.text.data(), col.text.size());
+        if (_is_ascii(text)) continue;
+        col.measured = true;
+        col.width = 0;
+        size_t begin = 0;
+        for (size_t end : col.ends) {
+            col.width = std::max(col.width, _display_width(text.substr(begin, end - begin)));
+            begin = end;
+        }
+    }
+
+    // Emits one line; cell(I) writes column I's content of the given width
+    auto line = [&](auto&& cell_width, auto&& cell, char fill, std::string_view sep) {
+        [&]<size_t... Is>(std::index_sequence<Is...>) {
+            auto one = [&]<size_t I>(std::integral_constant<size_t, I>) {
+                if constexpr (!field_plans_v<T>[I].skip) {
+                    if constexpr (_field_printed_before<T, I>()) {
+                        _write_text(policy, sep, ctx);
+                    }
+                    size_t width = std::max(cols[I].width, _display_width(field_plans_v<T>[I].name));
+                    size_t pad = width - cell_width(I);
+                    using member_type = std::remove_cvref_t<std::tuple_element_t<I, decltype(object_to_tuple(std::declval<T&>()))>>;
+                    bool right = std::is_arithmetic_v<member_type>;
+                    if (right) _write_fill(policy, fill, pad);
+                    cell(I);
+                    if (!right && (I != last_column || fill != ' ')) _write_fill(policy, fill, pad);
+                }
+            };
+            (one(std::integral_constant<size_t, Is>{}), ...);
+        }(std::make_index_sequence<columns>{});
+    };
+
+    line([](size_t i) { return _display_width(field_plans_v<T>[i].name); },
+         [&](size_t i) { _write_text(policy, field_plans_v<T>[i].name, ctx); }, ' ', " | ");
+    policy.write(literals<CharT>::newline);
+    line([](size_t) { return size_t(0); }, [](size_t) {}, '-', "-+-");
+    for (size_t r = 0; r < count; ++r) {
+        policy.write(literals<CharT>::newline);
+        auto text = [&](size_t i) {
+            size_t begin = r == 0 ? 0 : cols[i].ends[r - 1];
+            return std::basic_string_view<CharT>(cols[i].text.data() + begin, cols[i].ends[r] - begin);
+        };
+        line([&](size_t i) { return cols[i].measured ? _display_width(text(i)) : text(i).size(); },
+             [&](size_t i) { policy.write(text(i)); }, ' ', " | ");
+    }
+}
+
+// Types with a dedicated branch in _print_impl ahead of member reflection:
+// print views, user formatters, to_string() and string conversions
+template <typename T, typename Policy, typename Alloc>
+concept _custom_printed =
+    _concept::std_t::is_instance_of<T, formatted>::value || std::same_as<T, hexdump_view> ||
+    _concept::std_t::is_instance_of<T, summary_view>::value || _concept::std_t::is_instance_of<T, table_view>::value ||
+    _concept::std_t::is_fixed_string<T>::value || has_formatter<T, format_sink<Policy, Alloc>> ||
+    has_eprint_format<T, format_sink<Policy, Alloc>> || requires(const T& obj) { obj.to_string(); } ||
+    std::convertible_to<const T&, std::basic_string<typename Policy::char_type>>;
+
+// True when _print_impl prints T as "Type { member: value, ... }"
+template <typename T, typename Policy, typename Alloc>
+constexpr bool _prints_members = std::is_aggregate_v<T> && !std::is_array_v<T> && !std::ranges::range<T> &&
+                                 !std::same_as<T, std::monostate> && !_custom_printed<T, Policy, Alloc>;
+
+template <PrintPolicy Policy, typename Obj, typename Alloc>
+void _print_impl(Policy& policy, Obj&& obj, size_t depth, print_context<Alloc>& ctx) {
+    using CharT = typename Policy::char_type;
+    using Lit = literals<CharT>;
+    using Decay_Obj = std::decay_t<Obj>;
+    using string_type = std::basic_string<CharT>;
+    using string_view_type = std::basic_string_view<CharT>;
+
+    if constexpr (_concept::std_t::is_instance_of<Decay_Obj, formatted>::value) {
+        const format_spec* outer = ctx.spec;
+        ctx.spec = &obj.spec;
+        _print_impl(policy, obj.value, depth, ctx);
+        ctx.spec = outer;
+    } else if constexpr (std::same_as<Decay_Obj, hexdump_view>) {
+        _print_hexdump(policy, obj.data, obj.size, obj.style, ctx);
+    } else if constexpr (_concept::std_t::is_instance_of<Decay_Obj, summary_view>::value) {
+        _print_summary(policy, obj.range, ctx);
+    } else if constexpr (_concept::std_t::is_instance_of<Decay_Obj, table_view>::value) {
+        _print_table(policy, obj.range, ctx);
+    } else if constexpr (_concept::std_t::is_fixed_string<Decay_Obj>::value) {
+        _print_impl(policy, obj.view(), depth, ctx);
+    } else if constexpr (has_formatter<Decay_Obj, format_sink<Policy, Alloc>>) {
+        format_sink<Policy, Alloc> sink(policy, depth, ctx);
+        formatter<Decay_Obj>{}.format(sink, obj);
+    } else if constexpr (has_eprint_format<Decay_Obj, format_sink<Policy, Alloc>>) {
+        format_sink<Policy, Alloc> sink(policy, depth, ctx);
+        eprint_format(sink, obj);
+    } else if constexpr (_concept::std_t::is_instance_of<Decay_Obj, std::shared_ptr>::value) {
+        if (!obj) {
+            policy.write(Lit::null);
+        } else if (_enter_pointee(policy, obj.get(), ctx)) {
+            policy.write(Lit::address_prefix);
+            _write_number(policy, static_cast<const void*>(obj.get()));
+            policy.write(Lit::count_prefix);
+            _write_number(policy, obj.use_count());
+            _print_pointee(policy, obj, depth, ctx);
+            policy.write(Lit::close_brace);
+        }
+    } else if constexpr (_concept::std_t::is_instance_of<Decay_Obj, std::unique_ptr>::value) {
+        if (!obj) {
+            policy.write(Lit::null);
+        } else if (_enter_pointee(policy, obj.get(), ctx)) {
+            policy.write(Lit::address_prefix);
+            _write_number(policy, static_cast<const void*>(obj.get()));
+            _print_pointee(policy, obj, depth, ctx);
+            policy.write(Lit::close_brace);
+        }
+    } else if constexpr (_concept::string_like<Obj>) {
+        if (ctx.spec) {
+            size_t limit = ctx.spec->precision < 0 ? size_t(-1) : size_t(ctx.spec->precision);
+            size_t length = std::min(_source_view(obj).size(), limit);
+            _write_padded(policy, *ctx.spec, length + (depth != 0 ? 2 : 0), '<', [&] {
+                if (depth != 0) policy.write(Lit::quote);
+                _write_string(policy, obj, ctx, limit);
+                if (depth != 0) policy.write(Lit::quote);
+            });
+        } else if (depth != 0) {
+            policy.write(Lit::quote);
+            _write_string(policy, obj, ctx);
+            policy.write(Lit::quote);
+        } else {
+            _write_string(policy, obj, ctx);
+        }
+    } else if constexpr (std::is_arithmetic_v<Decay_Obj> || std::is_pointer_v<Decay_Obj>) {
+        if (const format_spec* spec = _number_spec<Decay_Obj>(ctx)) {
+            _write_number(policy, static_cast<Decay_Obj>(obj), *spec);
+        } else {
+            _write_number(policy, static_cast<Decay_Obj>(obj));
+        }
+    } else if constexpr (_concept::std_t::is_bitset<Decay_Obj>::value) {
+        // Ahead of the to_string() branch, which std::bitset would match
+        _print_bitset(policy, obj, ctx);
+    } else if constexpr (_concept::std_t::is_container_adaptor<Decay_Obj>) {
+        _print_impl(policy, _underlying(obj), depth, ctx);
+    } else if constexpr (requires { std::forward<Obj>(obj).to_string(); }) {
+        decltype(auto) str = std::forward<Obj>(obj).to_string();
+        if constexpr (std::is_convertible_v<decltype(str), string_view_type>) {
+            policy.write(string_view_type(str));
+        } else {
+            policy.write(string_type(std::move(str)));
+        }
+    } else if constexpr (std::convertible_to<Obj, string_type>) {
+        policy.write(string_type(std::forward<Obj>(obj)));
+    } else if constexpr (_concept::std_t::is_map<Decay_Obj>) {
+        _open_group(policy, Lit::open_brace, depth);
+        bool is_first = true;
+        auto print_entry = [&](auto&& pair) {
+            if (!is_first) {
+                _separator(policy, depth);
+            }
+            is_first = false;
+            _print_impl(policy, pair.first, depth + 1, ctx);
+            policy.write(Lit::colon_space);
+            _print_impl(policy, pair.second, depth + 1, ctx);
+        };
+        if (!_for_each_sorted(obj, ctx, print_entry)) {
+            for (auto&& pair : std::forward<Obj>(obj)) {
+                print_entry(pair);
+            }
+        }
+        _close_group(policy, Lit::close_brace, depth);
+    } else if constexpr (std::same_as<Decay_Obj, std::filesystem::path>) {
+        // Must be before range check since path is iterable
+        auto write_path = [&] {
+            if constexpr (std::same_as<std::filesystem::path::value_type, CharT>) {
+                policy.write(string_view_type(obj.native()));
+            } else {
+                using path_alloc = typename temp_string<CharT, Alloc>::allocator_type;
+                policy.write(obj.template string<CharT, std::char_traits<CharT>, path_alloc>(path_alloc(ctx.alloc)));
+            }
+        };
+        if (depth != 0) {
+            policy.write(Lit::quote);
+            write_path();
+            policy.write(Lit::quote);
+        } else {
+            write_path();
+        }
+    } else if constexpr (std::same_as<Decay_Obj, std::byte>) {
+        char hex[4] = {'0', 'x'};
+        _hex_encode(reinterpret_cast<const unsigned char*>(&obj), 1, hex + 2);
+        _write_chars(policy, hex, hex + 4);
+    } else if constexpr (std::ranges::range<Obj>) {
+        if constexpr (_concept::byte_buffer<Decay_Obj>) {
+            if (std::same_as<std::remove_cv_t<std::ranges::range_value_t<Decay_Obj>>, std::byte> || ctx.opts.bytes_as_hex) {
+                _print_hexdump(policy, reinterpret_cast<const unsigned char*>(std::ranges::data(obj)),
+                               std::ranges::size(obj), hexdump_style::compact, ctx);
+                return;
+            }
+        }
+        if constexpr (std::ranges::random_access_range<Obj> && std::ranges::sized_range<Obj> && !LayoutPolicy<Policy>) {
+            if (size_t workers = _parallel_workers(ctx.opts, std::ranges::size(obj)); workers > 1) {
+                _print_range_parallel(policy, obj, depth, ctx, workers);
+                return;
+            }
+        }
+        _open_group(policy, Lit::open_bracket, depth);
+        bool first = true;
+        auto print_element = [&](auto&& e) {
+            if (!first) _separator(policy, depth);
+            first = false;
+            _print_impl(policy, e, depth + 1, ctx);
+        };
+        if (!_for_each_sorted(obj, ctx, print_element)) {
+            for (auto&& e : std::forward<Obj>(obj)) {
+                print_element(e);
+            }
+        }
+        _close_group(policy, Lit::close_bracket, depth);
+    } else if constexpr (_concept::std_t::is_instance_of<Decay_Obj, std::pair>::value) {
+        _open_group(policy, Lit::open_paren, depth);
+        _print_impl(policy, obj.first, depth + 1, ctx);
+        _separator(policy, depth);
+        _print_impl(policy, obj.second, depth + 1, ctx);
+        _close_group(policy, Lit::close_paren, depth);
+    } else if constexpr (_concept::std_t::is_instance_of<Decay_Obj, std::tuple>::value) {
+        auto for_each = [](auto&& fn, auto... args) {
+            (fn(args), ...);
+        };
+        _open_group(policy, Lit::open_paren, depth);
+        bool is_first = true;
+        std::apply([&]<typename... Args_>(Args_&&... args) {
+            for_each([&]<typename T>(T&& ele) {
+                if (is_first) {
+                    _print_impl(policy, std::forward<T>(ele), depth + 1, ctx);
+                    is_first = false;
+                } else {
+                    _separator(policy, depth);
+                    _print_impl(policy, std::forward<T>(ele), depth + 1, ctx);
+                }
+            }, std::forward<Args_>(args)...);
+        }, obj);
+        _close_group(policy, Lit::close_paren, depth);
+    } else if constexpr (_concept::std_t::is_instance_of<Decay_Obj, std::optional>::value) {
+        if (obj.has_value()) {
+            _print_impl(policy, obj.value(), depth, ctx);
+        } else {
+            policy.write(Lit::none);
+        }
+    } else if constexpr (_concept::std_t::is_instance_of<Decay_Obj, std::complex>::value) {
+        _print_impl(policy, std::pair{obj.real(), obj.imag()}, depth + 1, ctx);
+    } else if constexpr (_concept::std_t::is_chrono_time_point<Decay_Obj>) {
+        using clock_type = typename Decay_Obj::clock;
+        if constexpr (std::is_same_v<clock_type, std::chrono::system_clock>) {
+            // system_clock: convert to readable date/time
+            auto time_t_val = std::chrono::system_clock::to_time_t(obj);
+            std::tm tm_val{};
+#ifdef _MSC_VER
+            localtime_s(&tm_val, &time_t_val);
+#else
+            localtime_r(&time_t_val, &tm_val);
+#endif
+            char buf[32];
+            size_t n = std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm_val);
+            _write_chars(policy, buf, buf + n);
+        } else {
+            // other clocks (steady_clock, high_resolution_clock, etc.): print duration since epoch
+            auto duration = obj.time_since_epoch();
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+            _write_number(policy, ns);
+            _write_text(policy, "ns since epoch", ctx);
+        }
+    } else if constexpr (_concept::std_t::is_instance_of<Decay_Obj, std::variant>::value) {
+        _print_variant(policy, obj, depth, ctx);
+    } else if constexpr (std::same_as<Decay_Obj, std::monostate>) {
+        policy.write(Lit::none);
+    } else if constexpr (std::same_as<Decay_Obj, std::any>) {
+        _print_any(policy, obj, depth, ctx);
+    } else if constexpr (_concept::std_t::is_expected<Decay_Obj>) {
+        if (obj.has_value()) {
+            if constexpr (std::is_void_v<typename Decay_Obj::value_type>) {
+                policy.write(Lit::open_paren);
+                policy.write(Lit::close_paren);
+            } else {
+                _print_impl(policy, *obj, depth, ctx);
+            }
+        } else {
+            policy.write(Lit::unexpected_prefix);
+            _print_impl(policy, obj.error(), depth + 1, ctx);
+            policy.write(Lit::close_paren);
+        }
+    } else if constexpr (_prints_members<Decay_Obj, Policy, Alloc>) {
+        using type = Decay_Obj;
+        auto members = object_to_tuple(obj);
+        if (depth != 0) {
+            _open_group(policy, Lit::open_brace, depth);
+        } else {
+            _write_text(policy, get_type_name<type>(), ctx);
+            policy.write(Lit::space);
+            _open_group(policy, Lit::open_brace, depth);
+        }
+        constexpr auto mc = members_count_v<type>;
+        auto inner_printer = [&]<size_t Is>(std::integral_constant<size_t, Is>, auto&& member_value) {
+            if constexpr (!field_plans_v<type>[Is].skip) {
+                if constexpr (_field_printed_before<type, Is>()) {
+                    _separator(policy, depth);
+                }
+                _write_text(policy, field_plans_v<type>[Is].name, ctx);
+                policy.write(Lit::colon_space);
+                _print_field<type, Is>(policy, member_value, depth + 1, ctx);
+            }
+        };
+        [&]<size_t ...Is>(std::index_sequence<Is...>){
+            (inner_printer(std::integral_constant<size_t, Is>{}, std::get<Is>(members)), ...);
+        }(std::make_index_sequence<mc>{});
+        _close_group(policy, Lit::close_brace, depth);
+    } else {
+        policy.write(Lit::lt);
+        _write_text(policy, get_type_name<Decay_Obj>(), ctx);
+        policy.write(Lit::at);
+        _write_number(policy, static_cast<const void*>(&obj));
+        policy.write(Lit::gt);
+    }
+}
+
+/////////////////////// DIFF ///////////////////////////////////////////////
+// operator== usable all the way down; the std containers declare it even
+// when their elements have none
+template <typename T>
+constexpr bool _deep_comparable() {
+    if constexpr (!std::equality_comparable<T>) {
+        return false;
+    } else if constexpr (_concept::std_t::is_map<T>) {
+        return _deep_comparable<typename T::key_type>() && _deep_comparable<typename T::mapped_type>();
+    } else if constexpr (_concept::std_t::is_instance_of<T, std::optional>::value) {
+        return _deep_comparable<typename T::value_type>();
+    } else if constexpr (_concept::std_t::is_instance_of<T, std::pair>::value) {
+        return _deep_comparable<typename T::first_type>() && _deep_comparable<typename T::second_type>();
+    } else if constexpr (std::ranges::range<T> && !_concept::string_like<T>) {
+        using value_type = std::ranges::range_value_t<T>;
+        return std::same_as<value_type, T> || _deep_comparable<value_type>();
+    } else {
+        return true;
+    }
+}
+
+struct absent_t {};
+struct redacted_t {};
+
+// Walks two snapshots in lockstep and reports each differing path as
+//     path: old -> new
+template <PrintPolicy Policy, typename Alloc>
+class diff_walker {
+    using CharT = typename Policy::char_type;
+    using Lit = literals<CharT>;
+    using path_type = temp_string<CharT, Alloc>;
+
+public:
+    diff_walker(Policy& policy, print_context<Alloc>& ctx, std::string_view root)
+        : policy_(policy), ctx_(ctx), path_(ctx.alloc) {
+        path_.assign(root.begin(), root.end());
+    }
+
+    size_t changes() const { return changes_; }
+
+    template <typename T>
+    void walk(const T& a, const T& b) {
+        if constexpr (_deep_comparable<T>()) {
+            if (a == b) {
+                return;
+            }
+        }
+        if constexpr (_concept::string_like<T>) {
+            if (differs(a, b)) {
+                report(a, b);
+            }
+        } else if constexpr (_concept::std_t::is_map<T>) {
+            if constexpr (requires { typename T::key_compare; }) {
+                merge_maps(a, b);
+            } else if constexpr (_concept::std_t::is_multi<T>) {
+                lookup_multimaps(a, b);
+            } else {
+                lookup_maps(a, b);
+            }
+        } else if constexpr (_concept::std_t::is_set<T>) {
+            if constexpr (requires { typename T::key_compare; }) {
+                merge_sets(a, b);
+            } else {
+                lookup_sets(a, b);
+            }
+        } else if constexpr (_concept::std_t::is_instance_of<T, std::optional>::value) {
+            if (a && b) {
+                walk(*a, *b);
+            } else if (a || b) {
+                report(a, b);
+            }
+        } else if constexpr (std::ranges::forward_range<const T>) {
+            walk_ranges(a, b);
+        } else if constexpr (std::is_aggregate_v<T> && !std::is_array_v<T>) {
+            walk_members(a, b, std::make_index_sequence<members_count_v<T>>{});
+        } else if (differs(a, b)) {
+            report(a, b);
+        }
+    }
+
+private:
+    template <typename T>
+    bool differs(const T& a, const T& b) {
+        if constexpr (_concept::string_like<T>) {
+            // By content: character pointers would compare addresses
+            if constexpr (std::is_pointer_v<T>) {
+                if (!a || !b) return a != b;
+            }
+            return _source_view(a) != _source_view(b);
+        } else if constexpr (_deep_comparable<T>()) {
+            return !(a == b);
+        } else {
+            // No operator==: compare what would be printed
+            path_type text_a(ctx_.alloc), text_b(ctx_.alloc);
+            string_policy<CharT, path_type> pa{&text_a}, pb{&text_b};
+            _print_impl(pa, a, 1, ctx_);
+            _print_impl(pb, b, 1, ctx_);
+            return text_a != text_b;
+        }
+    }
+
+    template <typename T>
+    void value(const T& v) {
+        if constexpr (std::same_as<T, absent_t>) {
+            _write_text(policy_, "<absent>", ctx_);
+        } else if constexpr (std::same_as<T, redacted_t>) {
+            _write_text(policy_, "<redacted>", ctx_);
+        } else {
+            _print_impl(policy_, v, 1, ctx_);
+        }
+    }
+
+    template <typename A, typename B>
+    void report(const A& a, const B& b) {
+        if (!path_.empty()) {
+            policy_.write(path_);
+            policy_.write(Lit::colon_space);
+        }
+        value(a);
+        _write_text(policy_, " -> ", ctx_);
+        value(b);
+        policy_.write(Lit::newline);
+        ++changes_;
+    }
+
+    // Appends a path segment for the duration of f
+    template <typename Segment, typename F>
+    void nested(Segment&& segment, F&& f) {
+        size_t mark = path_.size();
+        segment();
+        f();
+        path_.resize(mark);
+    }
+
+    template <typename K>
+    auto key(const K& k) {
+        return [this, &k] {
+            path_.push_back(CharT('['));
+            string_policy<CharT, path_type> out{&path_};
+            _print_impl(out, k, 1, ctx_);
+            path_.push_back(CharT(']'));
+        };
+    }
+
+    auto index(size_t i) {
+        return [this, i] {
+            char buf[24];
+            auto res = std::to_chars(buf, std::end(buf), i);
+            path_.push_back(CharT('['));
+            path_.append(buf, res.ptr);
+            path_.push_back(CharT(']'));
+        };
+    }
+
+    auto member(std::string_view name) {
+        return [this, name] {
+            if (!path_.empty()) {
+                path_.push_back(CharT('.'));
+            }
+            path_.append(name.begin(), name.end());
+        };
+    }
+
+    // Sorted maps: one linear merge over both key sequences
+    template <typename T>
+    void merge_maps(const T& a, const T& b) {
+        auto comp = a.key_comp();
+        auto ia = a.begin(), ib = b.begin();
+        while (ia != a.end() || ib != b.end()) {
+            if (ib == b.end() || (ia != a.end() && comp(ia->first, ib->first))) {
+                nested(key(ia->first), [&] { report(ia->second, absent_t{}); });
+                ++ia;
+            } else if (ia == a.end() || comp(ib->first, ia->first)) {
+                nested(key(ib->first), [&] { report(absent_t{}, ib->second); });
+                ++ib;
+            } else {
+                nested(key(ia->first), [&] { walk(ia->second, ib->second); });
+                ++ia;
+                ++ib;
+            }
+        }
+    }
+
+    // Unordered maps: hash lookups in each direction
+    template <typename T>
+    void lookup_maps(const T& a, const T& b) {
+        for (const auto& [k, v] : a) {
+            auto it = b.find(k);
+            if (it == b.end()) {
+                nested(key(k), [&] { report(v, absent_t{}); });
+            } else {
+                nested(key(k), [&] { walk(v, it->second); });
+            }
+        }
+        for (const auto& [k, v] : b) {
+            if (!a.contains(k)) {
+                nested(key(k), [&] { report(absent_t{}, v); });
+            }
+        }
+    }
+
+    // Unordered multimaps: per key, entries with equal values cancel out
+    // whatever their order, the rest are paired in iteration order
+    template <typename T>
+    void lookup_multimaps(const T& a, const T& b) {
+        using iterator = typename T::const_iterator;
+        using iterator_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<iterator>;
+        std::vector<iterator, iterator_alloc> left(ctx_.alloc), right(ctx_.alloc);
+        for (auto it = a.begin(); it != a.end();) {
+            auto range_a = a.equal_range(it->first);
+            auto range_b = b.equal_range(it->first);
+            left.clear();
+            right.clear();
+            for (auto i = range_a.first; i != range_a.second; ++i) left.push_back(i);
+            for (auto i = range_b.first; i != range_b.second; ++i) right.push_back(i);
+            for (size_t l = 0; l < left.size();) {
+                auto same = std::find_if(right.begin(), right.end(),
+                                         [&](iterator r) { return !differs(left[l]->second, r->second); });
+                if (same != right.end()) {
+                    right.erase(same);
+                    left.erase(left.begin() + l);
+                } else {
+                    ++l;
+                }
+            }
+            if (!left.empty() || !right.empty()) {
+                nested(key(it->first), [&] {
+                    size_t paired = std::min(left.size(), right.size());
+                    for (size_t i = 0; i < paired; ++i) walk(left[i]->second, right[i]->second);
+                    for (size_t i = paired; i < left.size(); ++i) report(left[i]->second, absent_t{});
+                    for (size_t i = paired; i < right.size(); ++i) report(absent_t{}, right[i]->second);
+                });
+            }
+            it = range_a.second;
+        }
+        for (auto it = b.begin(); it != b.end();) {
+            auto range_b = b.equal_range(it->first);
+            if (!a.contains(it->first)) {
+                nested(key(it->first), [&] {
+                    for (auto i = range_b.first; i != range_b.second; ++i) report(absent_t{}, i->second);
+                });
+            }
+            it = range_b.second;
+        }
+    }
+
+    template <typename T>
+    void merge_sets(const T& a, const T& b) {
+        auto comp = a.key_comp();
+        auto ia = a.begin(), ib = b.begin();
+        while (ia != a.end() || ib != b.end()) {
+            if (ib == b.end() || (ia != a.end() && comp(*ia, *ib))) {
+                report(*ia++, absent_t{});
+            } else if (ia == a.end() || comp(*ib, *ia)) {
+                report(absent_t{}, *ib++);
+            } else {
+                ++ia;
+                ++ib;
+            }
+        }
+    }
+
+    // Unordered sets: per value, the surplus copies on either side; equal
+    // values are adjacent, so each group is visited once
+    template <typename T>
+    void lookup_sets(const T& a, const T& b) {
+        for (auto it = a.begin(); it != a.end();) {
+            auto group = a.equal_range(*it);
+            size_t in_a = std::distance(group.first, group.second);
+            for (size_t in_b = b.count(*it); in_b < in_a; ++in_b) report(*it, absent_t{});
+            it = group.second;
+        }
+        for (auto it = b.begin(); it != b.end();) {
+            auto group = b.equal_range(*it);
+            size_t in_b = std::distance(group.first, group.second);
+            for (size_t in_a = a.count(*it); in_a < in_b; ++in_a) report(absent_t{}, *it);
+            it = group.second;
+        }
+    }
+
+    // Sequences: element by element, then the longer tail
+    template <typename T>
+    void walk_ranges(const T& a, const T& b) {
+        auto ia = std::ranges::begin(a), ib = std::ranges::begin(b);
+        auto ea = std::ranges::end(a), eb = std::ranges::end(b);
+        size_t i = 0;
+        for (; ia != ea && ib != eb; ++ia, ++ib, ++i) {
+            nested(index(i), [&] { walk(*ia, *ib); });
+        }
+        for (; ia != ea; ++ia, ++i) {
+            nested(index(i), [&] { report(*ia, absent_t{}); });
+        }
+        for (; ib != eb; ++ib, ++i) {
+            nested(index(i), [&] { report(absent_t{}, *ib); });
+        }
+    }
+
+    // Aggregates: member by member, honouring field attributes
+    template <typename T, size_t... Is>
+    void walk_members(const T& a, const T& b, std::index_sequence<Is...>) {
+        auto ma = object_to_tuple(a);
+        auto mb = object_to_tuple(b);
+        auto one = [&]<size_t I>(std::integral_constant<size_t, I>) {
+            constexpr const field_plan& plan = field_plans_v<T>[I];
+            if constexpr (!plan.skip) {
+                const auto& va = std::get<I>(ma);
+                const auto& vb = std::get<I>(mb);
+                if constexpr (plan.redact) {
+                    if (differs(va, vb)) {
+                        nested(member(plan.name), [&] {
+                            report(redacted_t{}, redacted_t{});
+                        });
+                    }
+                } else {
+                    nested(member(plan.name), [&] { walk(va, vb); });
+                }
+            }
+        };
+        (one(std::integral_constant<size_t, Is>{}), ...);
+    }
+
+    Policy& policy_;
+    print_context<Alloc>& ctx_;
+    path_type path_;
+    size_t changes_ = 0;
+};
+/////////////////////// DIFF ///////////////////////////////////////////////
+
+}
+
+
+/////////////////////// STATS //////////////////////////////////////////////
+// Printer instrumentation, compiled in only when EPRINT_STATS is defined
+// before the header is included. It must be defined the same way in every
+// translation unit, since it changes the layout of Printer.
+#if defined(EPRINT_STATS)
+inline constexpr bool stats_enabled = true;
+#else
+inline constexpr bool stats_enabled = false;
+#endif
+
+struct printer_family_stats {
+    uint64_t arguments = 0;
+    uint64_t chars = 0; // not attributed in pretty mode
 };
 
-template <class T>
-Wrapper(T) -> Wrapper<T>;
+struct printer_stats_by_family {
+    printer_family_stats numbers;
+    printer_family_stats strings;
+    printer_family_stats ranges;
+    printer_family_stats maps;
+    printer_family_stats aggregates;
+    printer_family_stats pointers;
+    printer_family_stats other;
+};
 
-// This workaround is necessary for clang.
-template <class T>
-inline constexpr auto wrap(const T& arg) noexcept {
-    return Wrapper{arg};
+// Snapshot of a Printer's counters, summed over all threads
+struct printer_stats {
+    uint64_t calls = 0;     // print, println and print_diff calls
+    uint64_t chars = 0;     // characters handed to the policy
+    uint64_t writes = 0;    // policy.write calls
+    uint64_t format_ns = 0; // time formatting, excluding policy calls
+    uint64_t write_ns = 0;  // time in policy.write and flush
+    // The times are measured on one call in timing_interval per thread and
+    // scaled up; reading the clock around every write would cost more than
+    // most writes do
+    uint64_t timed_calls = 0;
+    printer_stats_by_family families;
+};
+
+namespace _inner {
+
+enum class type_family : size_t { numbers, strings, ranges, maps, aggregates, pointers, other, count };
+
+template <typename T>
+constexpr type_family _type_family() {
+    using U = std::remove_cvref_t<T>;
+    if constexpr (std::is_arithmetic_v<U> || std::is_enum_v<U>) {
+        return type_family::numbers;
+    } else if constexpr (_concept::string_like<U>) {
+        return type_family::strings;
+    } else if constexpr (_concept::std_t::is_map<U>) {
+        return type_family::maps;
+    } else if constexpr (std::ranges::range<U>) {
+        return type_family::ranges;
+    } else if constexpr (std::is_pointer_v<U> || _concept::std_t::is_instance_of<U, std::shared_ptr>::value ||
+                         _concept::std_t::is_instance_of<U, std::unique_ptr>::value) {
+        return type_family::pointers;
+    } else if constexpr (std::is_aggregate_v<U>) {
+        return type_family::aggregates;
+    } else {
+        return type_family::other;
+    }
+}
+
+inline uint64_t _stats_now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Counters of one call, accumulated without atomics and published once
+struct call_stats {
+    bool timed = false;
+    uint64_t chars = 0;
+    uint64_t writes = 0;
+    uint64_t write_ns = 0;
+    std::array<uint64_t, size_t(type_family::count)> family_args{};
+    std::array<uint64_t, size_t(type_family::count)> family_chars{};
+};
+
+// Forwards to the real target, counting and timing every write
+template <PrintPolicy Target>
+struct stats_policy {
+    using char_type = typename Target::char_type;
+    Target& target;
+    call_stats& stats;
+    void write(std::basic_string_view<char_type> sv) {
+        if (stats.timed) {
+            uint64_t start = _stats_now();
+            target.write(sv);
+            stats.write_ns += _stats_now() - start;
+        } else {
+            target.write(sv);
+        }
+        stats.chars += sv.size();
+        ++stats.writes;
+    }
+};
+
+template <bool Enabled>
+class stats_recorder {
+public:
+    struct timer {};
+    timer start(call_stats&) { return {}; }
+    void record(timer, const call_stats&) {}
+    printer_stats snapshot() const { return {}; }
+    void reset() {}
+};
+
+inline std::atomic<size_t> _stats_thread_counter{0};
+
+// Threads are spread over cache-line-sized slots, so concurrent printers
+// on different threads do not contend; threads sharing a slot stay correct
+// through the atomics
+template <>
+class stats_recorder<true> {
+    static constexpr size_t slot_count = 16;
+    static constexpr size_t families = size_t(type_family::count);
+    static constexpr uint64_t timing_interval = 8;
+
+    struct alignas(64) slot {
+        std::atomic<uint64_t> calls{0};
+        std::atomic<uint64_t> timed_calls{0};
+        std::atomic<uint64_t> chars{0};
+        std::atomic<uint64_t> writes{0};
+        std::atomic<uint64_t> format_ns{0};
+        std::atomic<uint64_t> write_ns{0};
+        std::array<std::atomic<uint64_t>, families> family_args{};
+        std::array<std::atomic<uint64_t>, families> family_chars{};
+    };
+
+    static size_t thread_slot() {
+        thread_local size_t index = _stats_thread_counter.fetch_add(1, std::memory_order_relaxed) % slot_count;
+        return index;
+    }
+
+public:
+    stats_recorder() = default;
+    // A copied Printer starts with its own zeroed counters; a moved one
+    // takes the counters along and leaves zeroed ones behind
+    stats_recorder(const stats_recorder&) : stats_recorder() {}
+    stats_recorder& operator=(const stats_recorder&) { return *this; }
+    stats_recorder(stats_recorder&& other) : stats_recorder() { slots_.swap(other.slots_); }
+    stats_recorder& operator=(stats_recorder&& other) {
+        slots_.swap(other.slots_);
+        other.reset();
+        return *this;
+    }
+
+    struct timer {
+        uint64_t start;
+    };
+    timer start(call_stats& call) {
+        thread_local uint64_t calls = 0;
+        call.timed = calls++ % timing_interval == 0;
+        return {call.timed ? _stats_now() : 0};
+    }
+
+    void record(timer t, const call_stats& call) {
+        slot& s = slots_[thread_slot()];
+        auto add = [](std::atomic<uint64_t>& counter, uint64_t value) {
+            counter.fetch_add(value, std::memory_order_relaxed);
+        };
+        add(s.calls, 1);
+        add(s.chars, call.chars);
+        add(s.writes, call.writes);
+        if (call.timed) {
+            uint64_t total = _stats_now() - t.start;
+            add(s.timed_calls, 1);
+            add(s.write_ns, call.write_ns);
+            add(s.format_ns, total > call.write_ns ? total - call.write_ns : 0);
+        }
+        for (size_t f = 0; f < families; ++f) {
+            if (call.family_args[f] != 0) {
+                add(s.family_args[f], call.family_args[f]);
+                add(s.family_chars[f], call.family_chars[f]);
+            }
+        }
+    }
+
+    printer_stats snapshot() const {
+        printer_stats out;
+        printer_family_stats* by_family[] = {&out.families.numbers, &out.families.strings, &out.families.ranges,
+                                             &out.families.maps, &out.families.aggregates, &out.families.pointers,
+                                             &out.families.other};
+        for (size_t i = 0; i < slot_count; ++i) {
+            const slot& s = slots_[i];
+            out.calls += s.calls.load(std::memory_order_relaxed);
+            out.timed_calls += s.timed_calls.load(std::memory_order_relaxed);
+            out.chars += s.chars.load(std::memory_order_relaxed);
+            out.writes += s.writes.load(std::memory_order_relaxed);
+            out.format_ns += s.format_ns.load(std::memory_order_relaxed);
+            out.write_ns += s.write_ns.load(std::memory_order_relaxed);
+            for (size_t f = 0; f < families; ++f) {
+                by_family[f]->arguments += s.family_args[f].load(std::memory_order_relaxed);
+                by_family[f]->chars += s.family_chars[f].load(std::memory_order_relaxed);
+            }
+        }
+        if (out.timed_calls != 0) {
+            double scale = double(out.calls) / out.timed_calls;
+            out.format_ns = uint64_t(out.format_ns * scale);
+            out.write_ns = uint64_t(out.write_ns * scale);
+        }
+        return out;
+    }
+
+    void reset() {
+        for (size_t i = 0; i < slot_count; ++i) {
+            slot& s = slots_[i];
+            for (auto* counter : {&s.calls, &s.timed_calls, &s.chars, &s.writes, &s.format_ns, &s.write_ns}) {
+                counter->store(0, std::memory_order_relaxed);
+            }
+            for (size_t f = 0; f < families; ++f) {
+                s.family_args[f].store(0, std::memory_order_relaxed);
+                s.family_chars[f].store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    std::unique_ptr<slot[]> slots_ = std::make_unique<slot[]>(slot_count);
+};
+
+}
+/////////////////////// STATS //////////////////////////////////////////////
+
+/////////////////////// PRINTER CLASS //////////////////////////////////////
+
+template <PrintPolicy PP, typename Alloc = arena_allocator<typename std::decay_t<PP>::char_type>>
+class Printer {
+    PP policy_;
+    print_options options_;
+    [[no_unique_address]] Alloc alloc_;
+    [[no_unique_address]] _inner::stats_recorder<stats_enabled> stats_;
+    using Policy = std::decay_t<PP>;
+    using context = _inner::print_context<Alloc>;
+    using scope = _inner::alloc_scope<Alloc>;
+public:
+    using char_type = typename Policy::char_type;
+    using allocator_type = Alloc;
+    using string_type = std::basic_string<char_type>;
+    using string_view_type = std::basic_string_view<char_type>;
+    using Lit = literals<char_type>;
+
+    constexpr Printer() requires std::default_initializable<Policy> = default;
+    template <class P>
+    constexpr Printer(P&& policy, const Alloc& alloc = Alloc()) : policy_(std::forward<P>(policy)), alloc_(alloc) {}
+
+    // Access policy
+    Policy& policy() { return policy_; }
+    const Policy& policy() const { return policy_; }
+
+    // Access formatting options
+    print_options& options() { return options_; }
+    const print_options& options() const { return options_; }
+
+    // Counters collected when built with EPRINT_STATS; all zero otherwise
+    printer_stats stats() const { return stats_.snapshot(); }
+    void reset_stats() { stats_.reset(); }
+
+    // Single object print
+    template <typename Obj>
+    void print(Obj&& obj) {
+        emit(false, std::forward<Obj>(obj));
+    }
+
+    template <typename Obj>
+    void println(Obj&& obj) {
+        emit(true, std::forward<Obj>(obj));
+    }
+
+    // Multiple arguments print
+    template <typename... Args>
+    void print(Args&&... args) {
+        emit(false, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    void println(Args&&... args) {
+        emit(true, std::forward<Args>(args)...);
+    }
+
+    // Type name print
+    template <typename TypeName>
+    void print() {
+        emit_type_name<TypeName>(false);
+    }
+
+    template <typename TypeName>
+    void println() {
+        emit_type_name<TypeName>(true);
+    }
+
+    // Print only what changed between two snapshots, one line per differing
+    // path, e.g. "cfg.limits[3].max: 10 -> 20". Equal subtrees are skipped
+    // with operator== where available. Returns the number of changes.
+    template <typename T>
+    size_t print_diff(const T& before, const T& after, std::string_view root = {}) {
+        size_t changes = 0;
+        output([&](auto& target) {
+            scope guard;
+            context ctx{options_, alloc_};
+            _inner::diff_walker<std::remove_reference_t<decltype(target)>, Alloc> walker(target, ctx, root);
+            walker.walk(before, after);
+            changes = walker.changes();
+        });
+        return changes;
+    }
+
+    // Convert to string without output
+    template <typename Obj>
+    string_type to_string(Obj&& obj) {
+        string_type result;
+        _inner::string_policy<char_type> sp{&result};
+        format_args(sp, nullptr, std::forward<Obj>(obj));
+        return result;
+    }
+
+private:
+    template <typename... Args>
+    void emit(bool newline, Args&&... args) {
+        output([&](auto& target, _inner::call_stats* call = nullptr) {
+            format_args(target, call, std::forward<Args>(args)...);
+            if (newline) target.write(Lit::newline);
+        });
+    }
+
+    template <typename TypeName>
+    void emit_type_name(bool newline) {
+        output([&](auto& target) {
+            scope guard;
+            context ctx{options_, alloc_};
+            _inner::_write_text(target, _inner::get_type_name<std::remove_reference_t<TypeName>>(), ctx);
+            if (newline) target.write(Lit::newline);
+        });
+    }
+
+    // Runs body against the policy and flushes it. With EPRINT_STATS the
+    // policy is wrapped to count and time writes, and the call is recorded.
+    template <typename Body>
+    void output(Body&& body) {
+        if constexpr (stats_enabled) {
+            _inner::call_stats call;
+            auto timer = stats_.start(call);
+            _inner::stats_policy<Policy> counted{policy_, call};
+            if constexpr (std::invocable<Body&, decltype(counted)&, _inner::call_stats*>) {
+                body(counted, &call);
+            } else {
+                body(counted);
+            }
+            if constexpr (FlushablePolicy<Policy>) {
+                if (call.timed) {
+                    uint64_t start = _inner::_stats_now();
+                    policy_.flush();
+                    call.write_ns += _inner::_stats_now() - start;
+                } else {
+                    policy_.flush();
+                }
+            }
+            stats_.record(timer, call);
+        } else {
+            body(policy_);
+            if constexpr (FlushablePolicy<Policy>) {
+                policy_.flush();
+            }
+        }
+    }
+
+    // All object output goes through here; pretty mode formats the arguments
+    // into one layout document so columns carry across arguments.
+    template <PrintPolicy Target, typename... Args>
+    void format_args(Target& target, [[maybe_unused]] _inner::call_stats* call, Args&&... args) {
+        scope guard;
+        [[maybe_unused]] context ctx{options_, alloc_};
+        std::optional<_inner::address_set<Alloc>> visited;
+        if (options_.deep_pointers) {
+            ctx.visited = &visited.emplace(alloc_);
+        }
+        if (options_.pretty_width != 0) {
+            _inner::layout_policy<char_type, Alloc> doc(alloc_);
+            (print_arg(doc, call, std::forward<Args>(args), ctx), ...);
+            doc.emit(target, options_.pretty_width, options_.pretty_indent);
+        } else {
+            (print_arg(target, call, std::forward<Args>(args), ctx), ...);
+        }
+    }
+
+    template <PrintPolicy Target, typename Arg>
+    void print_arg(Target& target, _inner::call_stats* call, Arg&& arg, context& ctx) {
+        if constexpr (stats_enabled) {
+            if (call) {
+                constexpr auto family = size_t(_inner::_type_family<Arg>());
+                uint64_t before = call->chars;
+                _inner::_print_impl(target, std::forward<Arg>(arg), 0, ctx);
+                ++call->family_args[family];
+                // Zero in pretty mode: the layout document is written after
+                // the last argument
+                call->family_chars[family] += call->chars - before;
+                return;
+            }
+        }
+        _inner::_print_impl(target, std::forward<Arg>(arg), 0, ctx);
+    }
+};
+template <class P>
+Printer(P&& p) -> Printer<P>;
+
+
+/////////////////////// CHUNK READER ///////////////////////////////////////
+// Pull-based formatting: the traversal runs on a producer thread whose
+// policy fills one chunk and then waits until the consumer asks for the
+// next, so memory stays at the traversal stack plus one chunk however large
+// the object is. Pretty and parallel modes, which buffer whole documents,
+// are switched off.
+template <typename CharT = char, typename Alloc = arena_allocator<CharT>>
+class chunk_reader {
+    struct cancelled {};
+
+    struct chunk_policy {
+        using char_type = CharT;
+        chunk_reader* reader;
+        void write(std::basic_string_view<CharT> sv) { reader->produce(sv); }
+    };
+
+public:
+    // obj must outlive the reader
+    template <typename Obj>
+    chunk_reader(const Obj& obj, size_t chunk_size, print_options options = {})
+        : chunk_size_(std::max<size_t>(chunk_size, 1)), options_(std::move(options)) {
+        options_.pretty_width = 0;
+        options_.parallel_threshold = 0;
+        buffer_.reserve(chunk_size_);
+        producer_ = std::thread([this, &obj] {
+            try {
+                _inner::alloc_scope<Alloc> guard;
+                _inner::print_context<Alloc> ctx{options_, Alloc()};
+                std::optional<_inner::address_set<Alloc>> visited;
+                if (options_.deep_pointers) {
+                    ctx.visited = &visited.emplace(Alloc());
+                }
+                chunk_policy policy{this};
+                _inner::_print_impl(policy, obj, 0, ctx);
+            } catch (const cancelled&) {
+                return;
+            } catch (...) {
+                error_ = std::current_exception(); // published by finished_
+            }
+            finished_ = true;
+            ready_.release();
+        });
+    }
+
+    chunk_reader(const chunk_reader&) = delete;
+    chunk_reader& operator=(const chunk_reader&) = delete;
+
+    ~chunk_reader() {
+        if (!started_) {
+            ready_.acquire(); // producer parked on its first chunk, or done
+        }
+        if (!finished_) {
+            cancel_ = true;
+            resume_.release();
+        }
+        producer_.join();
+    }
+
+    // Next chunk of at most chunk_size characters, valid until the next
+    // call; empty once the whole object has been produced. An exception
+    // thrown while formatting is rethrown here, dropping the chunk it
+    // interrupted, and the reader is exhausted afterwards.
+    std::basic_string_view<CharT> next() {
+        if (exhausted_) {
+            return {};
+        }
+        if (started_) {
+            resume_.release();
+        }
+        started_ = true;
+        ready_.acquire();
+        if (finished_) {
+            exhausted_ = true;
+            if (error_) {
+                std::rethrow_exception(std::exchange(error_, nullptr));
+            }
+        }
+        return buffer_;
+    }
+
+    bool done() const { return exhausted_; }
+
+private:
+    void produce(std::basic_string_view<CharT> sv) {
+        while (!sv.empty()) {
+            size_t n = std::min(sv.size(), chunk_size_ - buffer_.size());
+            buffer_.append(sv.substr(0, n));
+            sv.remove_prefix(n);
+            if (buffer_.size() == chunk_size_) {
+                ready_.release();
+                resume_.acquire();
+                if (cancel_) {
+                    throw cancelled{};
+                }
+                buffer_.clear();
+            }
+        }
+    }
+
+    size_t chunk_size_;
+    print_options options_;
+    std::basic_string<CharT> buffer_;
+    std::binary_semaphore ready_{0};  // producer -> consumer: chunk ready
+    std::binary_semaphore resume_{0}; // consumer -> producer: chunk taken
+    bool started_ = false;            // consumer side
+    bool exhausted_ = false;
+    std::atomic<bool> finished_{false};
+    std::atomic<bool> cancel_{false};
+    std::exception_ptr error_;
+    std::thread producer_;
+};
+/////////////////////// CHUNK READER ///////////////////////////////////////
+
+
+/////////////////////// CACHED PRINTER /////////////////////////////////////
+namespace _inner {
+
+inline uint64_t _hash_mix(uint64_t seed, uint64_t value) {
+    return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
 }
 
+// Ranges whose elements are not the range itself (filesystem::path is)
+template <typename T>
+concept _element_hashable = std::ranges::input_range<const T> && !std::same_as<std::ranges::range_value_t<const T>, T>;
 
+// Cheap change detector: a user version counter (eprint_version(obj) via ADL
+// or obj.version()), std::hash, or a fold over elements and members.
+// nullopt means the type cannot be hashed and is always re-formatted.
 template <typename T>
-inline constexpr auto struct_to_tuple() {
-    return object_tuple_view_helper<T, members_count_v<T>>::tuple_view();
+std::optional<uint64_t> _content_hash(const T& obj) {
+    if constexpr (requires { { eprint_version(obj) } -> std::convertible_to<uint64_t>; }) {
+        return eprint_version(obj);
+    } else if constexpr (requires { { obj.version() } -> std::convertible_to<uint64_t>; }) {
+        return obj.version();
+    } else if constexpr (_concept::string_like<T>) {
+        auto view = _source_view(obj);
+        return std::hash<decltype(view)>{}(view);
+    } else if constexpr (_concept::std_t::is_instance_of<T, std::shared_ptr>::value ||
+                         _concept::std_t::is_instance_of<T, std::unique_ptr>::value) {
+        // std::hash covers only the address; the printed text also shows
+        // the pointee and the use count
+        if constexpr (!requires { _content_hash(*obj); }) {
+            return std::nullopt;
+        } else {
+            if (!obj) return 0;
+            auto h = _content_hash(*obj);
+            if (!h) return std::nullopt;
+            uint64_t seed = _hash_mix(reinterpret_cast<std::uintptr_t>(obj.get()), *h);
+            if constexpr (_concept::std_t::is_instance_of<T, std::shared_ptr>::value) {
+                seed = _hash_mix(seed, static_cast<uint64_t>(obj.use_count()));
+            }
+            return seed;
+        }
+    } else if constexpr (std::is_pointer_v<T>) {
+        // Raw pointers are always re-formatted rather than trusting the address
+        return std::nullopt;
+    } else if constexpr (requires { { std::hash<T>{}(obj) } -> std::convertible_to<size_t>; }) {
+        return std::hash<T>{}(obj);
+    } else if constexpr (_concept::std_t::is_instance_of<T, std::optional>::value) {
+        if (!obj) return 0;
+        auto h = _content_hash(*obj);
+        return h ? std::optional<uint64_t>(_hash_mix(1, *h)) : std::nullopt;
+    } else if constexpr (_concept::std_t::is_instance_of<T, std::pair>::value) {
+        auto first = _content_hash(obj.first);
+        auto second = _content_hash(obj.second);
+        return first && second ? std::optional<uint64_t>(_hash_mix(*first, *second)) : std::nullopt;
+    } else if constexpr (_element_hashable<T>) {
+        uint64_t seed = 0, count = 0;
+        for (const auto& elem : obj) {
+            auto h = _content_hash(elem);
+            if (!h) return std::nullopt;
+            seed = _hash_mix(seed, *h);
+            ++count;
+        }
+        return _hash_mix(seed, count);
+    } else if constexpr (std::is_aggregate_v<T> && !std::is_array_v<T>) {
+        auto members = object_to_tuple(obj);
+        std::optional<uint64_t> seed = 0;
+        [&]<size_t... Is>(std::index_sequence<Is...>) {
+            auto one = [&]<size_t I>(std::integral_constant<size_t, I>) {
+                if constexpr (!field_plans_v<T>[I].skip) {
+                    auto h = seed ? _content_hash(std::get<I>(members)) : std::nullopt;
+                    seed = h ? std::optional<uint64_t>(_hash_mix(*seed, *h)) : std::nullopt;
+                }
+            };
+            (one(std::integral_constant<size_t, Is>{}), ...);
+        }(std::make_index_sequence<members_count_v<T>>{});
+        return seed;
+    } else {
+        return std::nullopt;
+    }
 }
 
-template <typename _Ty>
-inline constexpr std::array<std::string_view, members_count_v<_Ty>>
-get_member_names() {
-    constexpr size_t member_count = members_count<_Ty>();
-    using T = std::remove_cvref_t<_Ty>;
-    std::array<std::string_view, member_count> arr;
-    constexpr auto tp = struct_to_tuple<T>();
-    [&]<size_t... Is>(std::index_sequence<Is...>){ //Change
-        ((arr[Is] = get_member_name<wrap(std::get<Is>(tp))>()), ...);
-    }(std::make_index_sequence<member_count>{});
-    return arr;
 }
 
+// Printer for objects that are printed again and again while mostly
+// unchanged. Formatted text is cached per (object address, top-level member)
+// together with a content hash; a member is re-formatted only when its hash
+// changed. The cache is bounded to max_bytes of text, evicting least
+// recently used fragments. Pretty and deep pointer modes bypass the cache,
+// and any change made through options() drops it.
+template <PrintPolicy PP, typename Alloc = arena_allocator<typename std::decay_t<PP>::char_type>>
+class cached_printer {
+    using Policy = std::decay_t<PP>;
+    using CharT = typename Policy::char_type;
+    using Lit = literals<CharT>;
+    using text_type = std::basic_string<CharT>;
+    using context = _inner::print_context<Alloc>;
+
+    static constexpr size_t whole_object = size_t(-1);
+
+    struct key {
+        const void* object;
+        size_t member;
+        bool operator==(const key&) const = default;
+    };
+    struct key_hash {
+        size_t operator()(const key& k) const noexcept {
+            return _inner::_hash_mix(std::hash<const void*>{}(k.object), k.member);
+        }
+    };
+    struct fragment {
+        uint64_t hash;
+        text_type text;
+        typename std::list<key>::iterator lru;
+    };
+
+    PP policy_;
+    [[no_unique_address]] Alloc alloc_;
+    Printer<Policy&, Alloc> printer_;
+    size_t max_bytes_;
+    size_t bytes_ = 0;
+    std::unordered_map<key, fragment, key_hash> cache_;
+    std::list<key> lru_; // most recently used first
+    print_options cached_options_; // options the cached text was formatted with
+    size_t hits_ = 0;
+    size_t misses_ = 0;
+
+public:
+    using char_type = CharT;
+
+    cached_printer() requires std::default_initializable<Policy>
+        : cached_printer(Policy{}) {}
+    template <class P>
+    explicit cached_printer(P&& policy, size_t max_bytes = size_t(1) << 20, const Alloc& alloc = Alloc())
+        : policy_(std::forward<P>(policy)), alloc_(alloc), printer_(policy_, alloc), max_bytes_(max_bytes) {}
+
+    cached_printer(const cached_printer&) = delete;
+    cached_printer& operator=(const cached_printer&) = delete;
+
+    Policy& policy() { return policy_; }
+    print_options& options() { return printer_.options(); }
+
+    template <typename T>
+    void print(const T& obj) {
+        write(obj);
+        if constexpr (FlushablePolicy<Policy>) {
+            policy_.flush();
+        }
+    }
+
+    template <typename T>
+    void println(const T& obj) {
+        write(obj);
+        policy_.write(Lit::newline);
+        if constexpr (FlushablePolicy<Policy>) {
+            policy_.flush();
+        }
+    }
+
+    // Drop every fragment of one object, e.g. before it is destroyed and
+    // its address reused
+    void invalidate(const void* object) {
+        for (auto it = lru_.begin(); it != lru_.end();) {
+            auto next = std::next(it);
+            if (it->object == object) {
+                erase(cache_.find(*it));
+            }
+            it = next;
+        }
+    }
+
+    void invalidate() {
+        cache_.clear();
+        lru_.clear();
+        bytes_ = 0;
+    }
+
+    size_t cached_bytes() const { return bytes_; }
+    size_t hits() const { return hits_; }
+    size_t misses() const { return misses_; }
+
+private:
+    template <typename T>
+    void write(const T& obj) {
+        const print_options& opts = printer_.options();
+        if (opts.pretty_width != 0 || opts.deep_pointers) {
+            printer_.print(obj);
+            return;
+        }
+        if (!(opts == cached_options_)) {
+            invalidate();
+            cached_options_ = opts;
+        }
+        _inner::alloc_scope<Alloc> guard;
+        context ctx{opts, alloc_};
+        if constexpr (_inner::_prints_members<T, Policy, Alloc>) {
+            auto members = _inner::object_to_tuple(obj);
+            _inner::_write_text(policy_, _inner::get_type_name<T>(), ctx);
+            policy_.write(Lit::space);
+            policy_.write(Lit::open_brace);
+            [&]<size_t... Is>(std::index_sequence<Is...>) {
+                auto one = [&]<size_t I>(std::integral_constant<size_t, I>) {
+                    constexpr const field_plan& plan = _inner::field_plans_v<T>[I];
+                    if constexpr (!plan.skip) {
+                        if constexpr (_inner::_field_printed_before<T, I>()) {
+                            policy_.write(Lit::comma_space);
+                        }
+                        _inner::_write_text(policy_, plan.name, ctx);
+                        policy_.write(Lit::colon_space);
+                        write_fragment(&obj, I, std::get<I>(members), [&](auto& target) {
+                            _inner::_print_field<T, I>(target, std::get<I>(members), 1, ctx);
+                        });
+                    }
+                };
+                (one(std::integral_constant<size_t, Is>{}), ...);
+            }(std::make_index_sequence<_inner::members_count_v<T>>{});
+            policy_.write(Lit::close_brace);
+        } else {
+            write_fragment(&obj, whole_object, obj, [&](auto& target) {
+                _inner::_print_impl(target, obj, 0, ctx);
+            });
+        }
+    }
+
+    template <typename Member, typename Format>
+    void write_fragment(const void* object, size_t index, const Member& member, Format&& format) {
+        std::optional<uint64_t> hash = _inner::_content_hash(member);
+        if (!hash) {
+            ++misses_;
+            format(policy_);
+            return;
+        }
+        auto it = cache_.find(key{object, index});
+        if (it != cache_.end() && it->second.hash == *hash) {
+            ++hits_;
+            lru_.splice(lru_.begin(), lru_, it->second.lru);
+            policy_.write(it->second.text);
+            return;
+        }
+        ++misses_;
+        text_type text;
+        _inner::string_policy<CharT> target{&text};
+        format(target);
+        policy_.write(text);
+        if (it != cache_.end()) {
+            erase(it);
+        }
+        store(key{object, index}, *hash, std::move(text));
+    }
 
-template <typename T>
-constexpr auto object_to_tuple(T&& obj) {
-    using type = std::decay_t<T>;
-    return object_tuple_view_helper<type, members_count_v<type>>::tuple_view(obj);
-}
+    void store(const key& k, uint64_t hash, text_type&& text) {
+        size_t size = text.size() * sizeof(CharT);
+        if (size > max_bytes_) {
+            return;
+        }
+        while (bytes_ + size > max_bytes_ && !lru_.empty()) {
+            erase(cache_.find(lru_.back()));
+        }
+        lru_.push_front(k);
+        cache_.emplace(k, fragment{hash, std::move(text), lru_.begin()});
+        bytes_ += size;
+    }
 
-//---members_name---end
+    void erase(typename std::unordered_map<key, fragment, key_hash>::iterator it) {
+        bytes_ -= it->second.text.size() * sizeof(CharT);
+        lru_.erase(it->second.lru);
+        cache_.erase(it);
+    }
+};
+/////////////////////// CACHED PRINTER /////////////////////////////////////
 
-/////////////////////// AGGREGATE TYPE /////////////////////////////////////
 
+/////////////////////// PARSER /////////////////////////////////////////////
+namespace _inner {
 
-// Helper to convert value to string for Policy output
-template <typename CharT, typename T>
-std::basic_string<CharT> to_basic_string(T&& val) {
-    std::basic_ostringstream<CharT> oss;
-    oss << std::forward<T>(val);
-    return oss.str();
-}
+// Zero-copy cursor over printed text; whitespace between tokens is
+// insignificant so pretty-printed output reads back too.
+class scanner {
+public:
+    explicit scanner(std::string_view text) : text_(text) {}
 
-template <PrintPolicy Policy, typename Obj>
-void _print_impl(Policy& policy, Obj&& obj, size_t depth = 0) {
-    using CharT = typename Policy::char_type;
-    using Lit = literals<CharT>;
-    using Decay_Obj = std::decay_t<Obj>;
-    using string_type = std::basic_string<CharT>;
-    using string_view_type = std::basic_string_view<CharT>;
+    bool done() const { return pos_ == text_.size(); }
+    std::string_view rest() const { return text_.substr(pos_); }
+    void advance(size_t n) { pos_ += n; }
 
-    if constexpr (_concept::std_t::is_instance_of<Decay_Obj, std::shared_ptr>::value) {
-        if (!obj) {
-            policy.write(Lit::null);
-        } else {
-            policy.write(Lit::address_prefix);
-            policy.write(to_basic_string<CharT>(static_cast<void*>(obj.get())));
-            policy.write(Lit::count_prefix);
-            policy.write(to_basic_string<CharT>(obj.use_count()));
-            policy.write(Lit::close_brace);
-        }
-    } else if constexpr (_concept::std_t::is_instance_of<Decay_Obj, std::unique_ptr>::value) {
-        if (!obj) {
-            policy.write(Lit::null);
-        } else {
-            policy.write(Lit::address_prefix);
-            policy.write(to_basic_string<CharT>(static_cast<void*>(obj.get())));
-            policy.write(Lit::close_brace);
+    void skip_spaces() {
+        while (pos_ < text_.size() && (text_[pos_] == ' ' || text_[pos_] == '\n' ||
+                                       text_[pos_] == '\r' || text_[pos_] == '\t')) {
+            ++pos_;
         }
-    } else if constexpr (_concept::string_like<Obj>) {
-        if (depth != 0) {
-            policy.write(Lit::quote);
-            if constexpr (std::is_convertible_v<Obj, string_view_type>) {
-                policy.write(string_view_type(std::forward<Obj>(obj)));
-            } else {
-                policy.write(string_type(std::forward<Obj>(obj)));
-            }
-            policy.write(Lit::quote);
-        } else {
-            if constexpr (std::is_convertible_v<Obj, string_view_type>) {
-                policy.write(string_view_type(std::forward<Obj>(obj)));
-            } else {
-                policy.write(string_type(std::forward<Obj>(obj)));
+    }
+
+    bool peek(char c) {
+        skip_spaces();
+        return pos_ < text_.size() && text_[pos_] == c;
+    }
+
+    bool consume(char c) {
+        if (!peek(c)) return false;
+        ++pos_;
+        return true;
+    }
+
+    bool consume(std::string_view token) {
+        skip_spaces();
+        if (!rest().starts_with(token)) return false;
+        pos_ += token.size();
+        return true;
+    }
+
+    // Quoted text up to the quote that ends the token; strings are printed
+    // without escapes, so an inner quote only ends it before a delimiter
+    bool quoted(std::string_view& out) {
+        if (!consume('"')) return false;
+        for (size_t end = text_.find('"', pos_); end != std::string_view::npos; end = text_.find('"', end + 1)) {
+            char next = end + 1 < text_.size() ? text_[end + 1] : ',';
+            if (std::string_view(",]}): \n\r\t").find(next) != std::string_view::npos) {
+                out = text_.substr(pos_, end - pos_);
+                pos_ = end + 1;
+                return true;
             }
         }
-    } else if constexpr (std::is_arithmetic_v<Decay_Obj> || std::is_pointer_v<Decay_Obj>) {
-        policy.write(to_basic_string<CharT>(std::forward<Obj>(obj)));
-    } else if constexpr (requires { std::forward<Obj>(obj).to_string(); }) {
-        policy.write(string_type(std::forward<Obj>(obj).to_string()));
-    } else if constexpr (std::convertible_to<Obj, string_type>) {
-        policy.write(string_type(std::forward<Obj>(obj)));
-    } else if constexpr (_concept::std_t::is_map<Decay_Obj>) {
-        policy.write(Lit::open_brace);
-        bool is_first = true;
-        for (auto&& pair : std::forward<Obj>(obj)) {
-            if (!is_first) {
-                policy.write(Lit::comma_space);
+        return false;
+    }
+
+    // Skip one value whose text cannot be read back (redacted, truncated,
+    // user formatted): up to the next delimiter at the same nesting level
+    void skip_value() {
+        skip_spaces();
+        int nesting = 0;
+        for (; pos_ < text_.size(); ++pos_) {
+            char c = text_[pos_];
+            if (c == '"') {
+                std::string_view ignored;
+                if (quoted(ignored)) --pos_;
+            } else if (c == '[' || c == '{' || c == '(') {
+                ++nesting;
+            } else if (c == ']' || c == '}' || c == ')') {
+                if (nesting-- == 0) break;
+            } else if (c == ',' && nesting == 0) {
+                break;
             }
-            is_first = false;
-            _print_impl(policy, pair.first, depth + 1);
-            policy.write(Lit::colon_space);
-            _print_impl(policy, pair.second, depth + 1);
         }
-        policy.write(Lit::close_brace);
-    } else if constexpr (std::same_as<Decay_Obj, std::filesystem::path>) {
-        // Must be before range check since path is iterable
-        auto path_str = obj.string();
-        if (depth != 0) {
-            policy.write(Lit::quote);
-            policy.write(string_type(path_str.begin(), path_str.end()));
-            policy.write(Lit::quote);
+        while (pos_ > 0 && text_[pos_ - 1] == ' ') --pos_;
+    }
+
+private:
+    std::string_view text_;
+    size_t pos_ = 0;
+};
+
+template <typename T>
+bool _parse_value(scanner& in, T& out, size_t depth);
+
+template <typename T>
+bool _parse_number(scanner& in, T& out) {
+    in.skip_spaces();
+    std::string_view text = in.rest();
+    const char* first = text.data();
+    const char* last = text.data() + text.size();
+    std::from_chars_result res;
+    if constexpr (std::is_floating_point_v<T>) {
+        res = std::from_chars(first, last, out);
+    } else {
+        bool negative = first != last && *first == '-';
+        const char* digits = first + negative;
+        int base = 10;
+        if (last - digits > 2 && digits[0] == '0' && (digits[1] | 0x20) == 'x') base = 16;
+        if (last - digits > 2 && digits[0] == '0' && (digits[1] | 0x20) == 'b') base = 2;
+        if (base == 10) {
+            res = std::from_chars(first, last, out);
         } else {
-            policy.write(string_type(path_str.begin(), path_str.end()));
-        }
-    } else if constexpr (std::ranges::range<Obj>) {
-        policy.write(Lit::open_bracket);
-        bool first = true;
-        for (auto&& e : std::forward<Obj>(obj)) {
-            if (!first) policy.write(Lit::comma_space);
-            first = false;
-            _print_impl(policy, e, depth + 1);
+            std::make_unsigned_t<T> mag{};
+            res = std::from_chars(digits + 2, last, mag, base);
+            out = negative ? static_cast<T>(0 - mag) : static_cast<T>(mag);
         }
-        policy.write(Lit::close_bracket);
-    } else if constexpr (_concept::std_t::is_instance_of<Decay_Obj, std::pair>::value) {
-        policy.write(Lit::open_paren);
-        _print_impl(policy, obj.first, depth + 1);
-        policy.write(Lit::comma_space);
-        _print_impl(policy, obj.second, depth + 1);
-        policy.write(Lit::close_paren);
-    } else if constexpr (_concept::std_t::is_instance_of<Decay_Obj, std::tuple>::value) {
-        auto for_each = [](auto&& fn, auto... args) {
-            (fn(args), ...);
-        };
-        policy.write(Lit::open_paren);
-        bool is_first = true;
-        std::apply([&]<typename... Args_>(Args_&&... args) {
-            for_each([&]<typename T>(T&& ele) {
-                if (is_first) {
-                    _print_impl(policy, std::forward<T>(ele), depth + 1);
-                    is_first = false;
-                } else {
-                    policy.write(Lit::comma_space);
-                    _print_impl(policy, std::forward<T>(ele), depth + 1);
+    }
+    if (res.ec != std::errc{}) return false;
+    in.advance(res.ptr - first);
+    return true;
+}
+
+// Elements of "[a, b]", "(a, b)" or "{ k: v }" until the closing delimiter
+template <typename F>
+bool _parse_list(scanner& in, char open, char close, F&& element) {
+    if (!in.consume(open)) return false;
+    if (in.consume(close)) return true;
+    do {
+        if (!element()) return false;
+    } while (in.consume(','));
+    return in.consume(close);
+}
+
+template <typename T, size_t... Is>
+bool _parse_members(scanner& in, T& out, size_t depth, std::index_sequence<Is...>) {
+    auto members = object_to_tuple(out);
+    bool ok = true;
+    auto one = [&]<size_t I>(std::integral_constant<size_t, I>) {
+        constexpr const field_plan& plan = field_plans_v<T>[I];
+        if constexpr (!plan.skip) {
+            if (!ok) return;
+            if constexpr (_field_printed_before<T, I>()) {
+                if (!in.consume(',')) {
+                    ok = false;
+                    return;
                 }
-            }, std::forward<Args_>(args)...);
-        }, obj);
-        policy.write(Lit::close_paren);
-    } else if constexpr (_concept::std_t::is_instance_of<Decay_Obj, std::optional>::value) {
-        if (obj.has_value()) {
-            _print_impl(policy, obj.value(), depth);
-        } else {
-            policy.write(Lit::none);
+            }
+            if (!in.consume(plan.name) || !in.consume(':')) {
+                ok = false;
+                return;
+            }
+            if constexpr (plan.redact || plan.formatter != size_t(-1) || plan.truncate != size_t(-1)) {
+                in.skip_value();
+            } else {
+                ok = _parse_value(in, std::get<I>(members), depth + 1);
+            }
         }
-    } else if constexpr (_concept::std_t::is_instance_of<Decay_Obj, std::complex>::value) {
-        _print_impl(policy, std::pair{obj.real(), obj.imag()}, depth + 1);
-    } else if constexpr (_concept::std_t::is_chrono_time_point<Decay_Obj>) {
-        using clock_type = typename Decay_Obj::clock;
-        if constexpr (std::is_same_v<clock_type, std::chrono::system_clock>) {
-            // system_clock: convert to readable date/time
-            auto time_t_val = std::chrono::system_clock::to_time_t(obj);
-            std::tm tm_val{};
-#ifdef _MSC_VER
-            localtime_s(&tm_val, &time_t_val);
-#else
-            localtime_r(&time_t_val, &tm_val);
-#endif
-            std::basic_ostringstream<CharT> oss;
-            oss << std::put_time(&tm_val, "%Y-%m-%d %H:%M:%S");
-            policy.write(oss.str());
-        } else {
-            // other clocks (steady_clock, high_resolution_clock, etc.): print duration since epoch
-            auto duration = obj.time_since_epoch();
-            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
-            std::basic_ostringstream<CharT> oss;
-            oss << ns << "ns since epoch";
-            policy.write(oss.str());
+    };
+    (one(std::integral_constant<size_t, Is>{}), ...);
+    return ok;
+}
+
+template <typename T>
+bool _parse_value(scanner& in, T& out, size_t depth) {
+    if constexpr (std::same_as<T, bool>) {
+        if (in.consume('1') || in.consume("true")) return out = true, true;
+        if (in.consume('0') || in.consume("false")) return out = false, true;
+        return false;
+    } else if constexpr (std::same_as<T, char>) {
+        in.skip_spaces();
+        if (in.done()) return false;
+        out = in.rest()[0];
+        in.advance(1);
+        return true;
+    } else if constexpr (std::is_arithmetic_v<T>) {
+        return _parse_number(in, out);
+    } else if constexpr (std::same_as<T, std::string> || std::same_as<T, std::string_view>) {
+        std::string_view text;
+        if (depth == 0) {
+            text = in.rest();
+            if (text.ends_with('\n')) text.remove_suffix(1);
+            in.advance(in.rest().size());
+        } else if (!in.quoted(text)) {
+            return false;
         }
-    } else if constexpr (std::is_aggregate_v<Decay_Obj>) {
-        using type = Decay_Obj;
-        auto members = object_to_tuple(obj);
-        auto members_name = get_member_names<type>();
-        if (depth != 0) {
-            policy.write(Lit::open_brace);
-        } else {
-            auto type_name = get_type_name<type>();
-            policy.write(string_type(type_name.begin(), type_name.end()));
-            policy.write(Lit::space);
-            policy.write(Lit::open_brace);
+        out = T(text);
+        return true;
+    } else if constexpr (_concept::std_t::is_instance_of<T, std::optional>::value) {
+        if (in.consume("None")) {
+            out.reset();
+            return true;
         }
-        constexpr auto mc = members_count_v<type>;
-        auto inner_printer = [&]<size_t Is>(std::integral_constant<size_t, Is>, auto member_name, auto&& member_value) {
-            if constexpr (Is != 0) {
-                policy.write(Lit::comma_space);
+        return _parse_value(in, out.emplace(), depth);
+    } else if constexpr (_concept::std_t::is_instance_of<T, std::pair>::value) {
+        return in.consume('(') && _parse_value(in, out.first, depth + 1) && in.consume(',') &&
+               _parse_value(in, out.second, depth + 1) && in.consume(')');
+    } else if constexpr (_concept::std_t::is_instance_of<T, std::tuple>::value) {
+        return std::apply([&](auto&... elems) {
+            size_t i = 0;
+            bool ok = in.consume('(');
+            ((ok = ok && (i++ == 0 || in.consume(',')) && _parse_value(in, elems, depth + 1)), ...);
+            return ok && in.consume(')');
+        }, out);
+    } else if constexpr (_concept::std_t::is_map<T>) {
+        out.clear();
+        return _parse_list(in, '{', '}', [&] {
+            typename T::key_type key{};
+            typename T::mapped_type value{};
+            if (!_parse_value(in, key, depth + 1) || !in.consume(':') || !_parse_value(in, value, depth + 1)) {
+                return false;
             }
-            policy.write(string_type(member_name.begin(), member_name.end()));
-            policy.write(Lit::colon_space);
-            _print_impl(policy, std::forward<decltype(member_value)>(member_value), depth + 1);
-        };
-        [&]<size_t ...Is>(std::index_sequence<Is...>){
-            (inner_printer(std::integral_constant<size_t, Is>{}, std::get<Is>(members_name), std::get<Is>(members)), ...);
-        }(std::make_index_sequence<mc>{});
-        policy.write(Lit::close_brace);
+            out.emplace(std::move(key), std::move(value));
+            return true;
+        });
+    } else if constexpr ((std::ranges::range<T> && requires { std::tuple_size<T>::value; }) ||
+                         (std::is_array_v<T> && !_concept::string_like<T>)) {
+        size_t i = 0;
+        return _parse_list(in, '[', ']', [&] {
+            return i < std::size(out) && _parse_value(in, out[i++], depth + 1);
+        }) && i == std::size(out);
+    } else if constexpr (std::ranges::range<T> && requires(T& c, std::ranges::range_value_t<T>&& v) {
+                             c.insert(c.end(), std::move(v)); }) {
+        out.clear();
+        return _parse_list(in, '[', ']', [&] {
+            std::ranges::range_value_t<T> value{};
+            if (!_parse_value(in, value, depth + 1)) return false;
+            out.insert(out.end(), std::move(value));
+            return true;
+        });
+    } else if constexpr (std::is_aggregate_v<T>) {
+        if (depth == 0) {
+            in.consume(get_type_name<T>());
+        }
+        return in.consume('{') &&
+               _parse_members(in, out, depth, std::make_index_sequence<members_count_v<T>>{}) &&
+               in.consume('}');
     } else {
-        policy.write(Lit::lt);
-        auto type_name = get_type_name<Decay_Obj>();
-        policy.write(string_type(type_name.begin(), type_name.end()));
-        policy.write(Lit::at);
-        policy.write(to_basic_string<CharT>(static_cast<const void*>(&obj)));
-        policy.write(Lit::gt);
+        static_assert(std::is_aggregate_v<T>, "ju::parse: no rule to read this type back");
+        return false;
     }
 }
 
 }
-/////////////////////// PRINTER CLASS //////////////////////////////////////
 
-template <PrintPolicy PP>
-class Printer {
-    PP policy_;
-    using Policy = std::decay_t<PP>;
-public:
-    using char_type = typename Policy::char_type;
-    using string_type = std::basic_string<char_type>;
-    using string_view_type = std::basic_string_view<char_type>;
-    using Lit = literals<char_type>;
+// Read text produced by a char printer back into a T: numbers, bool,
+// strings, optionals, pairs, tuples, sequences, sets, maps and reflected
+// aggregates (field attributes included). Whitespace is insignificant and a
+// trailing newline is ignored. std::string_view members and results point
+// into the input, so nothing is copied for them. Returns nullopt on
+// malformed input.
+template <typename T>
+std::optional<T> parse(std::string_view text) {
+    _inner::scanner in(text);
+    std::optional<T> result(std::in_place);
+    if (!_inner::_parse_value(in, *result, 0)) {
+        return std::nullopt;
+    }
+    in.skip_spaces();
+    if (!in.done()) {
+        return std::nullopt;
+    }
+    return result;
+}
+/////////////////////// PARSER /////////////////////////////////////////////
 
-    constexpr Printer() requires std::default_initializable<Policy> = default;
-    template <class P>
-    constexpr Printer(P&& policy) : policy_(std::forward<P>(policy)) {}
 
-    // Access policy
-    Policy& policy() { return policy_; }
-    const Policy& policy() const { return policy_; }
+/////////////////////// COMPILE-TIME FORMAT ////////////////////////////////
+namespace _inner {
 
-    // Single object print
-    template <typename Obj>
-    void print(Obj&& obj) {
-        _inner::_print_impl(policy_, std::forward<Obj>(obj));
-        if constexpr (FlushablePolicy<Policy>) {
-            policy_.flush();
-        }
+template <auto V>
+constexpr std::string_view get_raw_value() {
+#ifdef _MSC_VER
+    return __FUNCSIG__;
+#else
+    return __PRETTY_FUNCTION__;
+#endif
+}
+
+// Enumerator name of V without qualification, or empty if V has none
+template <auto V>
+constexpr std::string_view get_enum_name() {
+    constexpr std::string_view sample = get_raw_value<0>();
+    constexpr size_t prefix_length = sample.find(" 0") + 1;
+    constexpr size_t suffix_length = sample.size() - prefix_length - 1;
+    constexpr std::string_view str = get_raw_value<V>();
+    constexpr std::string_view name = str.substr(prefix_length, str.size() - prefix_length - suffix_length);
+    if (name.starts_with('(')) {
+        return {};
     }
+    size_t scope = name.rfind("::");
+    return scope == std::string_view::npos ? name : name.substr(scope + 2);
+}
 
-    template <typename Obj>
-    void println(Obj&& obj) {
-        _inner::_print_impl(policy_, std::forward<Obj>(obj));
-        policy_.write(Lit::newline);
-        if constexpr (FlushablePolicy<Policy>) {
-            policy_.flush();
+// Measures, then fills, the rendered text
+struct ct_counter {
+    size_t size = 0;
+    constexpr void put(char) { ++size; }
+    constexpr void put(std::string_view text) { size += text.size(); }
+};
+
+template <size_t N>
+struct ct_writer {
+    fixed_string<N> out;
+    size_t size = 0;
+    constexpr void put(char c) { out.data[size++] = c; }
+    constexpr void put(std::string_view text) {
+        for (char c : text) out.data[size++] = c;
+    }
+};
+
+template <typename Out, typename T>
+constexpr void _ct_integer(Out& out, T val) {
+    using U = std::make_unsigned_t<T>;
+    U mag = static_cast<U>(val);
+    if constexpr (std::is_signed_v<T>) {
+        if (val < 0) {
+            out.put('-');
+            mag = U(0) - mag;
         }
     }
+    char digits[40];
+    size_t n = 0;
+    do {
+        digits[n++] = char('0' + mag % 10);
+        mag /= 10;
+    } while (mag != 0);
+    while (n != 0) out.put(digits[--n]);
+}
 
-    // Multiple arguments print
-    template <typename... Args>
-    void print(Args&&... args) {
-        (_inner::_print_impl(policy_, std::forward<Args>(args)), ...);
-        if constexpr (FlushablePolicy<Policy>) {
-            policy_.flush();
+// Same text as to_chars(general, precision 6) at runtime, except that
+// exact ties may round differently
+template <typename Out, typename T>
+constexpr void _ct_float(Out& out, T val) {
+    double x = static_cast<double>(val);
+    if (x != x) return out.put("nan");
+    if (x < 0 || (x == 0 && 1 / x < 0)) {
+        out.put('-');
+        x = -x;
+    }
+    if (x == 0) return out.put('0');
+    if (x > 1.7976931348623157e308) return out.put("inf");
+    // Decimal exponent, then six significant digits with a single rounding
+    // step (powers of ten up to 1e22 are exact) and round-half-even
+    int exp = 0;
+    double y = x;
+    while (y >= 1e16) { y /= 1e16; exp += 16; }
+    while (y >= 10) { y /= 10; ++exp; }
+    while (y < 1e-15) { y *= 1e16; exp -= 16; }
+    while (y < 1) { y *= 10; --exp; }
+    auto scaled_digits = [&](int e) -> uint64_t {
+        int shift = 5 - e;
+        double p = 1;
+        for (int i = 0; i < (shift < 0 ? -shift : shift) && i < 22; ++i) p *= 10;
+        double t = shift > 22 || shift < -22 ? y * 1e5 : (shift >= 0 ? x * p : x / p);
+        auto whole = static_cast<uint64_t>(t);
+        double frac = t - static_cast<double>(whole);
+        return whole + (frac > 0.5 || (frac == 0.5 && (whole & 1)));
+    };
+    uint64_t digits = scaled_digits(exp);
+    if (digits < 100000) {
+        digits = scaled_digits(--exp);
+    }
+    if (digits >= 1000000) {
+        digits /= 10;
+        ++exp;
+    }
+    char d[6];
+    for (int i = 5; i >= 0; --i) {
+        d[i] = char('0' + digits % 10);
+        digits /= 10;
+    }
+    int last = 5;
+    while (last > 0 && d[last] == '0') --last;
+    if (exp < -4 || exp >= 6) {
+        out.put(d[0]);
+        if (last > 0) {
+            out.put('.');
+            for (int i = 1; i <= last; ++i) out.put(d[i]);
+        }
+        out.put('e');
+        out.put(exp < 0 ? '-' : '+');
+        int e = exp < 0 ? -exp : exp;
+        if (e < 10) out.put('0');
+        _ct_integer(out, e);
+    } else if (exp < 0) {
+        out.put("0.");
+        for (int i = -1; i > exp; --i) out.put('0');
+        for (int i = 0; i <= last; ++i) out.put(d[i]);
+    } else {
+        for (int i = 0; i <= exp; ++i) out.put(d[i]);
+        if (last > exp) {
+            out.put('.');
+            for (int i = exp + 1; i <= last; ++i) out.put(d[i]);
         }
     }
+}
 
-    template <typename... Args>
-    void println(Args&&... args) {
-        (_inner::_print_impl(policy_, std::forward<Args>(args)), ...);
-        policy_.write(Lit::newline);
-        if constexpr (FlushablePolicy<Policy>) {
-            policy_.flush();
+template <auto V, typename Out>
+constexpr void _ct_render(Out& out, size_t depth);
+
+// First n characters or elements of V, as _print_truncated writes them
+template <auto V, typename Out>
+constexpr void _ct_truncated(Out& out, size_t n, size_t depth) {
+    using T = std::remove_cvref_t<decltype(V)>;
+    if constexpr (_concept::std_t::is_fixed_string<T>::value) {
+        out.put('"');
+        out.put(V.view().substr(0, n));
+        if (V.size() > n) out.put("...");
+        out.put('"');
+    } else if constexpr (requires { std::tuple_size<T>::value; } && std::ranges::range<T>) {
+        constexpr size_t size = std::tuple_size_v<T>;
+        out.put('[');
+        [&]<size_t... Is>(std::index_sequence<Is...>) {
+            ((Is < n ? (out.put(Is == 0 ? "" : ", "), _ct_render<V[Is]>(out, depth + 1)) : void()), ...);
+        }(std::make_index_sequence<size>{});
+        if (size > n) {
+            out.put(", ... (+");
+            _ct_integer(out, size - n);
+            out.put(')');
         }
+        out.put(']');
+    } else {
+        _ct_render<V>(out, depth);
     }
+}
 
-    // Type name print
-    template <typename TypeName>
-    void print() {
-        auto type_name = _inner::get_type_name<std::remove_reference_t<TypeName>>();
-        policy_.write(string_type(type_name.begin(), type_name.end()));
-        if constexpr (FlushablePolicy<Policy>) {
-            policy_.flush();
+// Aggregate member I of V, honouring skip/rename/redact/truncate
+template <auto V, size_t I, typename Out>
+constexpr void _ct_member(Out& out, size_t depth) {
+    using T = std::remove_cvref_t<decltype(V)>;
+    constexpr const field_plan& plan = field_plans_v<T>[I];
+    static_assert(plan.skip || plan.redact || (!plan.spec && plan.formatter == size_t(-1)),
+                  "ju::ct_format: field::format and field::format_with need a runtime print");
+    if constexpr (!plan.skip) {
+        if constexpr (_field_printed_before<T, I>()) out.put(", ");
+        out.put(plan.name);
+        out.put(": ");
+        if constexpr (plan.redact) {
+            out.put("<redacted>");
+        } else if constexpr (plan.truncate != size_t(-1)) {
+            constexpr auto member = std::get<I>(object_to_tuple(V));
+            _ct_truncated<member>(out, plan.truncate, depth + 1);
+        } else {
+            constexpr auto member = std::get<I>(object_to_tuple(V));
+            _ct_render<member>(out, depth + 1);
         }
     }
+}
 
-    template <typename TypeName>
-    void println() {
-        auto type_name = _inner::get_type_name<std::remove_reference_t<TypeName>>();
-        policy_.write(string_type(type_name.begin(), type_name.end()));
-        policy_.write(Lit::newline);
-        if constexpr (FlushablePolicy<Policy>) {
-            policy_.flush();
+template <auto V, typename Out>
+constexpr void _ct_render(Out& out, size_t depth) {
+    using T = std::remove_cvref_t<decltype(V)>;
+    if constexpr (_concept::std_t::is_fixed_string<T>::value) {
+        if (depth != 0) out.put('"');
+        out.put(V.view());
+        if (depth != 0) out.put('"');
+    } else if constexpr (std::same_as<T, bool>) {
+        out.put(V ? '1' : '0');
+    } else if constexpr (std::same_as<T, char>) {
+        out.put(V);
+    } else if constexpr (std::is_enum_v<T>) {
+        constexpr std::string_view name = get_enum_name<V>();
+        if constexpr (name.empty()) {
+            _ct_integer(out, static_cast<std::underlying_type_t<T>>(V));
+        } else {
+            out.put(name);
+        }
+    } else if constexpr (std::is_integral_v<T>) {
+        _ct_integer(out, V);
+    } else if constexpr (std::is_floating_point_v<T>) {
+        _ct_float(out, V);
+    } else if constexpr (_concept::std_t::is_instance_of<T, std::pair>::value) {
+        out.put('(');
+        _ct_render<V.first>(out, depth + 1);
+        out.put(", ");
+        _ct_render<V.second>(out, depth + 1);
+        out.put(')');
+    } else if constexpr (requires { std::tuple_size<T>::value; } && std::ranges::range<T>) {
+        out.put('[');
+        [&]<size_t... Is>(std::index_sequence<Is...>) {
+            ((out.put(Is == 0 ? "" : ", "), _ct_render<V[Is]>(out, depth + 1)), ...);
+        }(std::make_index_sequence<std::tuple_size_v<T>>{});
+        out.put(']');
+    } else if constexpr (std::is_aggregate_v<T>) {
+        if (depth == 0) {
+            out.put(get_type_name<T>());
+            out.put(' ');
         }
+        out.put("{ ");
+        [&]<size_t... Is>(std::index_sequence<Is...>) {
+            (_ct_member<V, Is>(out, depth), ...);
+        }(std::make_index_sequence<members_count_v<T>>{});
+        out.put(" }");
+    } else {
+        static_assert(std::is_aggregate_v<T>, "ju::ct_format: type cannot be formatted at compile time");
     }
+}
 
-    // Convert to string without output
-    template <typename Obj>
-    string_type to_string(Obj&& obj) {
-        string_type result;
-        struct string_policy {
-            using char_type = Printer::char_type;
-            string_type* str;
-            void write(string_view_type sv) { str->append(sv); }
-        };
-        string_policy sp{&result};
-        _inner::_print_impl(sp, std::forward<Obj>(obj));
-        return result;
+}
+
+// Render V at compile time with the same rules as a runtime print: numbers,
+// bool, char, enumerators (by name), fixed_string, std::array, std::pair and
+// reflected aggregates with skip/rename/redact/truncate attributes.
+// field::format and field::format_with are rejected with a static_assert.
+// V must be usable as a template argument, so use fixed_string for text
+// members.
+template <auto V>
+consteval auto ct_format() {
+    constexpr size_t size = [] {
+        _inner::ct_counter counter;
+        _inner::_ct_render<V>(counter, 0);
+        return counter.size;
+    }();
+    _inner::ct_writer<size> writer;
+    _inner::_ct_render<V>(writer, 0);
+    return writer.out;
+}
+
+// Static storage for ct_format<V>(): printing it is a single write
+template <auto V>
+inline constexpr auto ct_text = ct_format<V>();
+/////////////////////// COMPILE-TIME FORMAT ////////////////////////////////
+
+
+/////////////////////// CALL SITES /////////////////////////////////////////
+// What ju_dbg knows about one of its expansions
+struct call_site_info {
+    uint32_t id;
+    std::string_view file;
+    uint32_t line;
+    std::string_view function;
+    std::string_view expression;
+};
+
+namespace _inner {
+
+struct call_site_registry {
+    std::mutex mutex;
+    std::vector<call_site_info> sites;
+};
+
+inline call_site_registry& _call_sites() {
+    static call_site_registry registry;
+    return registry;
+}
+
+}
+
+// Every ju_dbg call site reached so far, in registration order; the id is
+// the index, so a compact log can record ids and resolve them later
+inline std::vector<call_site_info> call_sites() {
+    auto& registry = _inner::_call_sites();
+    std::lock_guard lock(registry.mutex);
+    return registry.sites;
+}
+
+// Registered once per ju_dbg expansion and character type, on first use.
+// The "[file:line] expr = " prefix is built here, so each later call
+// writes it with a single policy.write.
+template <typename CharT>
+struct call_site {
+    uint32_t id;
+    std::basic_string<CharT> prefix;
+
+    call_site(std::string_view expression, const std::source_location& loc) {
+        std::string_view file = loc.file_name();
+        if (auto slash = file.find_last_of("/\\"); slash != std::string_view::npos) {
+            file.remove_prefix(slash + 1);
+        }
+        auto& registry = _inner::_call_sites();
+        {
+            std::lock_guard lock(registry.mutex);
+            id = static_cast<uint32_t>(registry.sites.size());
+            registry.sites.push_back({id, file, loc.line(), loc.function_name(), expression});
+        }
+        std::string text = "[";
+        text.append(file).append(":").append(std::to_string(loc.line())).append("] ");
+        text.append(expression).append(" = ");
+        prefix.assign(text.begin(), text.end());
     }
 };
-template <class P>
-Printer(P&& p) -> Printer<P>;
+/////////////////////// CALL SITES /////////////////////////////////////////
 
 
 // Factory functions
@@ -741,7 +5224,16 @@ inline ju::Printer<cout_policy> jo;
 /////////////////////// MACROS /////////////////////////////////////////////
 
 #define ju_tostring(x) #x
-#define ju_dbg(e) jo.println(ju_tostring(e), ": ", e)
-#define ju_dbg_with(printer, e) (printer).println(ju_tostring(e), ": ", e)
+// Prints "[file:line] e = value". The lambda gives every expansion its own
+// static call site; the location is taken at the caller.
+#define ju_dbg(e) ju_dbg_with(jo, e)
+#define ju_dbg_with(printer, e)                                                                            \
+    (printer).println(                                                                                     \
+        [](const std::source_location& loc) -> const auto& {                                               \
+            using ju_char_type = typename std::remove_cvref_t<decltype(printer)>::char_type;              \
+            static const ::ju::call_site<ju_char_type> site(ju_tostring(e), loc);                          \
+            return site;                                                                                   \
+        }(std::source_location::current()).prefix,                                                         \
+        e)
 
 #endif //EPRINT_HPP
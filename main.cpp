@@ -15,7 +15,30 @@
 #include <sstream>
 #include <chrono>
 #include <thread>
-
+#include <atomic>
+#include <cstdlib>
+#include <csignal>
+#include <cstdio>
+#include <climits>
+#include <fstream>
+#include <span>
+
+// Counts every operator new in the process, see test_allocations()
+static std::atomic<size_t> g_new_calls{0};
+// Called through a pointer so GCC does not pair it with operator new
+static void (*volatile g_free)(void*) = std::free;
+
+void* operator new(std::size_t size) {
+    ++g_new_calls;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc{};
+}
+void operator delete(void* p) noexcept {
+    g_free(p);
+}
+void operator delete(void* p, std::size_t) noexcept {
+    ::operator delete(p);
+}
 
 void print_section(const char* title) {
     std::cout << "\n========== " << title << " ==========\n";
@@ -260,6 +283,22 @@ void test_dbg_macro() {
     ju_dbg(nums);
 
     ju_dbg(1 + 2 + 3);
+
+    // A call site is registered once however often it runs
+    struct counting_policy {
+        using char_type = char;
+        size_t writes = 0;
+        void write(std::string_view) { ++writes; }
+    };
+    auto printer = ju::make_printer(counting_policy{});
+    size_t sites_before = ju::call_sites().size();
+    for (int i = 0; i < 1000; ++i) {
+        ju_dbg_with(printer, i);
+    }
+    auto sites = ju::call_sites();
+    jo.println("new sites: ", sites.size() - sites_before, ", writes per call: ", printer.policy().writes / 1000);
+    jo.println("last site: ", sites.back().file, ":", sites.back().line, " ", sites.back().expression,
+               ", id matches index: ", sites.back().id == sites.size() - 1);
 }
 
 // ==================== Test: Output to stream ====================
@@ -419,6 +458,1348 @@ void test_custom_printer() {
     uio.println("start with tag: ui");
 }
 
+// ==================== Test: Parallel formatting ====================
+void test_parallel_format() {
+    print_section("Parallel Formatting");
+
+    struct Sample {
+        int id;
+        double value;
+        std::string tag;
+    };
+    std::vector<Sample> samples(200000);
+    for (int i = 0; i < static_cast<int>(samples.size()); ++i) {
+        samples[i] = {i, i * 0.5, "s" + std::to_string(i % 97)};
+    }
+
+    ju::Printer<cout_policy> printer;
+    auto serial = printer.to_string(samples);
+
+    printer.options().parallel_threshold = 1024;
+    for (unsigned threads : {1u, 2u, 4u, 8u, 16u}) {
+        printer.options().parallel_threads = threads;
+        auto start = std::chrono::steady_clock::now();
+        auto parallel = printer.to_string(samples);
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+        jo.println(threads, " threads: ", elapsed.count(), "us, identical: ", parallel == serial);
+    }
+
+    printer.options().parallel_threshold = 2;
+    printer.options().parallel_threads = 3;
+    jo.println("small vector, 3 threads: ", printer.to_string(std::vector<std::string>{"a", "b", "c", "d"}));
+
+    // A throwing element reaches the caller instead of terminating a worker
+    struct Fragile {
+        int id;
+        std::string to_string() const {
+            if (id == 1500) throw std::runtime_error("element " + std::to_string(id) + " failed");
+            return "ok";
+        }
+    };
+    std::vector<Fragile> fragile(4000);
+    for (int i = 0; i < 4000; ++i) fragile[i].id = i;
+    printer.options().parallel_threshold = 1024;
+    printer.options().parallel_threads = 4;
+    try {
+        printer.to_string(fragile);
+        jo.println("no exception");
+    } catch (const std::runtime_error& e) {
+        jo.println("rethrown from worker: ", e.what());
+    }
+    fragile[1500].id = 0;
+    jo.println("pool reused after a failure, size: ", printer.to_string(fragile).size());
+}
+
+// Standard allocator that counts its allocations, shared by all threads
+static std::atomic<size_t> g_counted_allocs{0};
+
+template <typename T>
+struct counting_allocator {
+    using value_type = T;
+
+    counting_allocator() = default;
+    template <typename U>
+    counting_allocator(const counting_allocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        ++g_counted_allocs;
+        return std::allocator<T>{}.allocate(n);
+    }
+    void deallocate(T* p, size_t n) noexcept { std::allocator<T>{}.deallocate(p, n); }
+
+    template <typename U>
+    bool operator==(const counting_allocator<U>&) const noexcept { return true; }
+};
+
+// ==================== Test: Allocations ====================
+void test_allocations() {
+    print_section("Allocations");
+
+    struct null_policy {
+        using char_type = char;
+        size_t bytes = 0;
+        void write(std::string_view sv) { bytes += sv.size(); }
+    };
+    struct wnull_policy {
+        using char_type = wchar_t;
+        size_t bytes = 0;
+        void write(std::wstring_view sv) { bytes += sv.size(); }
+    };
+    struct Reading {
+        std::string sensor;
+        int id;
+        double value;
+        std::vector<int> history;
+        std::map<std::string, int> limits;
+        std::optional<double> calibration;
+    };
+    Reading r{"thermometer-with-a-long-name", 7, 21.5, {1, 2, 3},
+              {{"min", -10}, {"max", 40}}, 0.25};
+
+    auto count_steady_state = [&](auto& printer) {
+        for (int i = 0; i < 3; ++i) printer.println(r); // warm up
+        size_t before = g_new_calls;
+        for (int i = 0; i < 1000; ++i) printer.println(r);
+        return g_new_calls - before;
+    };
+    auto printer = ju::make_printer(null_policy{});
+    auto wprinter = ju::make_printer(wnull_policy{});
+    jo.println("operator new calls (char, 1000 printlns): ", count_steady_state(printer));
+    jo.println("operator new calls (wchar_t, 1000 printlns): ", count_steady_state(wprinter));
+
+    ju::Printer<null_policy, std::allocator<char>> std_printer;
+    jo.println("std::allocator printer output matches: ",
+               std_printer.to_string(r) == printer.to_string(r));
+
+    // Parallel chunk buffers go through a custom allocator too
+    std::vector<Reading> readings(4096, r);
+    ju::Printer<null_policy, counting_allocator<char>> counted;
+    counted.options().parallel_threshold = 1024;
+    counted.options().parallel_threads = 4;
+    size_t counted_before = g_counted_allocs;
+    std::string parallel_text = counted.to_string(readings);
+    jo.println("parallel buffers use the printer's allocator: ", g_counted_allocs > counted_before,
+               ", output matches: ", parallel_text == printer.to_string(readings));
+}
+
+// ==================== Test: Pretty printing ====================
+void test_pretty_print() {
+    print_section("Pretty Printing");
+
+    struct Employee {
+        std::string name;
+        int age;
+        std::vector<std::string> skills;
+    };
+    std::map<std::string, std::vector<Employee>> teams{
+        {"compiler", {{"Alice", 30, {"C++", "LLVM"}}, {"Bob", 41, {"C", "Rust", "Assembly", "Verilog"}}}},
+        {"web", {{"Carol", 25, {"TypeScript"}}}},
+    };
+
+    ju::Printer<cout_policy> printer;
+    printer.options().pretty_width = 60;
+    printer.println("teams: ", teams);
+    printer.println(std::vector{1, 2, 3});
+
+    printer.options().pretty_indent = 2;
+    printer.options().pretty_width = 20;
+    printer.println(std::tuple{std::pair{1, "one"}, std::vector<int>{}, std::optional<double>{2.5}});
+
+    printer.options().pretty_width = 1000;
+    jo.println("wide pretty == single line: ", printer.to_string(teams) == jo.to_string(teams));
+}
+
+// ==================== Test: Deep pointers ====================
+struct Node {
+    int id;
+    std::shared_ptr<Node> next;
+};
+
+struct Tree {
+    std::string label;
+    std::unique_ptr<Tree> left;
+    std::unique_ptr<Tree> right;
+};
+
+// Members that reject braced probes next to C arrays, which plain probes
+// would be brace-elided into
+struct PtrArray {
+    std::shared_ptr<int> p;
+    int a[2];
+};
+
+struct Mixed {
+    std::function<int()> f;
+    int a[3];
+    std::shared_ptr<int> q;
+    double b[2];
+    std::filesystem::path path;
+};
+
+void test_deep_pointers() {
+    print_section("Deep Pointers");
+
+    ju::Printer<cout_policy> printer;
+    printer.options().deep_pointers = true;
+
+    auto a = std::make_shared<Node>(Node{1, nullptr});
+    auto b = std::make_shared<Node>(Node{2, a});
+    printer.println("list: ", b);
+
+    a->next = b; // a -> b -> a
+    printer.println("cycle: ", a);
+    a->next.reset();
+
+    auto shared = std::make_shared<int>(7);
+    printer.println("aliased: ", std::vector{shared, shared});
+
+    Tree tree{"root", std::make_unique<Tree>(Tree{"l", nullptr, nullptr}), nullptr};
+    printer.println("tree: ", tree);
+    printer.println("arrays after a shared_ptr: ", PtrArray{shared, {1, 2}});
+    printer.println("mixed: ", Mixed{[] { return 1; }, {1, 2, 3}, nullptr, {0.5, 1.5}, "/tmp"});
+
+    std::vector<std::shared_ptr<int>> many;
+    for (int i = 0; i < 100; ++i) many.push_back(std::make_shared<int>(i));
+    many.push_back(many.front());
+    auto text = printer.to_string(many);
+    jo.println("100 nodes + alias, back-reference at end: ", text.ends_with(">]"));
+}
+
+// ==================== Test: Vocabulary types ====================
+void test_vocabulary_types() {
+    print_section("variant / any / expected / adaptors / bitset");
+
+    std::variant<int, std::string, std::vector<double>> v1{42};
+    std::variant<int, std::string, std::vector<double>> v2{std::string("text")};
+    std::variant<std::monostate, int> v3;
+    jo.println("variant<int>: ", v1);
+    jo.println("variant<string>: ", v2);
+    jo.println("variant<monostate>: ", v3);
+    jo.println("vector<variant>: ", std::vector{v1, v2});
+
+    struct Custom { int x; };
+    jo.println("any(int): ", std::any{7});
+    jo.println("any(string): ", std::any{std::string("hi")});
+    jo.println("any(empty): ", std::any{});
+    jo.println("any(Custom): ", std::any{Custom{1}});
+
+#if defined(__cpp_lib_expected)
+    std::expected<int, std::string> ok{5};
+    std::expected<int, std::string> err{std::unexpected("bad input")};
+    jo.println("expected (value): ", ok);
+    jo.println("expected (error): ", err);
+#endif
+
+    std::queue<int> q;
+    for (int i : {1, 2, 3}) q.push(i);
+    std::stack<std::string> st;
+    for (auto s : {"a", "b"}) st.push(s);
+    std::priority_queue<int> pq;
+    for (int i : {3, 1, 4, 1, 5}) pq.push(i);
+    jo.println("queue (front to back): ", q);
+    jo.println("stack (bottom to top): ", st);
+    jo.println("priority_queue (heap order): ", pq);
+
+    jo.println("bitset<8>: ", std::bitset<8>{0b10110001});
+    jo.println("bitset<70>: ", std::bitset<70>{0xF0F0F0F0F0F0F0F0ull} << 3);
+    std::bitset<130> wide;
+    wide.set(129).set(64).set(0);
+    jo.println("bitset<130> matches to_string: ", jo.to_string(wide) == wide.to_string());
+
+    // bitset::to_string() has no wchar_t overload without arguments, so a
+    // wide printer only compiles through the bitset branch
+    ju::Printer<wcout_policy> wide_printer;
+    std::bitset<200> pattern;
+    for (size_t i = 0; i < pattern.size(); i += 3) pattern.set(i);
+    jo.println("wide bitset<200> matches: ",
+               wide_printer.to_string(pattern) == pattern.to_string<wchar_t>(L'0', L'1'));
+}
+
+void test_format_spec() {
+    print_section("format specs");
+
+    jo.println("{:#x} 255: ", ju::fmt(255, "{:#x}"));
+    jo.println("{:.2f} pi: ", ju::fmt(3.14159, "{:.2f}"));
+    jo.println("{:08b} 42: ", ju::fmt(42, "{:08b}"));
+    jo.println("{:+e} 1234.5: ", ju::fmt(1234.5, "{:+e}"));
+    jo.println("{:*^6} \"hi\": ", ju::fmt("hi", "{:*^6}"));
+    jo.println("{:.3} string: ", ju::fmt(std::string("truncate"), "{:.3}"));
+    jo.println("{:>5} vector: ", ju::fmt(std::vector{1, 22, 333}, "{:>5}"));
+    jo.println("{:<6} map: ", ju::fmt(std::map<std::string, int>{{"a", 1}, {"bb", -2}}, "{:<6}"));
+
+    std::array<uint32_t, 4> regs{0xdeadbeef, 0x10, 0, 0xffff};
+    jo.println("register dump: ", ju::fmt(regs, "{:#010x}"));
+
+    ju::Printer<cout_policy> money;
+    money.options().float_format = ju::format_spec("{:.3f}");
+    money.println("float_format {:.3f}: ", std::vector{1.0, 2.5, 1.0 / 3});
+
+    ju::Printer<wcout_policy> wide;
+    std::wstring ws = wide.to_string(ju::fmt(std::vector{10, 11}, "{:#X}"));
+    jo.println("wide {:#X} matches: ", ws == L"[0XA, 0XB]");
+
+    // Thousands of digits, past the stack buffer
+    long double huge = std::numeric_limits<long double>::max();
+    std::vector<char> expected(8192);
+    std::snprintf(expected.data(), expected.size(), "%#.0Lf", huge);
+    std::string fixed = jo.to_string(ju::fmt(huge, "{:#.0f}"));
+    jo.println("{:#.0f} max long double: ", fixed.size(), " chars, matches printf: ", fixed == expected.data());
+}
+
+// ==================== User formatters ====================
+struct Vec3 {
+    float x, y, z;
+};
+
+template <>
+struct ju::formatter<Vec3> {
+    template <typename Sink>
+    void format(Sink& out, const Vec3& v) {
+        out.write("Vec3(");
+        out.print(v.x);
+        out.write(", ");
+        out.print(v.y);
+        out.write(", ");
+        out.print(v.z);
+        out.write(")");
+    }
+};
+
+namespace shop {
+struct Money {
+    long cents;
+    std::string currency;
+};
+
+// Found by ADL; takes precedence over aggregate reflection
+template <typename Sink>
+void eprint_format(Sink& out, const Money& m) {
+    out.print(ju::fmt(m.cents / 100, "{}"));
+    out.write(".");
+    out.print(ju::fmt(m.cents % 100, "{:02}"));
+    out.write(" ");
+    out.write(m.currency);
+}
+}
+
+void test_user_formatter() {
+    print_section("User formatters");
+
+    jo.println("formatter<Vec3>: ", Vec3{1, 2.5f, -3});
+    jo.println("vector<Vec3>: ", std::vector<Vec3>{{0, 0, 0}, {1, 1, 1}});
+    jo.println("eprint_format(Money): ", shop::Money{1234, "EUR"});
+    jo.println("map<string, Money>: ", std::map<std::string, shop::Money>{{"book", {905, "USD"}}});
+
+    struct counting_policy {
+        using char_type = char;
+        size_t bytes = 0;
+        void write(std::string_view sv) { bytes += sv.size(); }
+    };
+    auto printer = ju::make_printer(counting_policy{});
+    std::vector<Vec3> points(16, Vec3{1, 2, 3});
+    printer.println(points); // warm up the arena
+    size_t before = g_new_calls;
+    for (int i = 0; i < 100; ++i) printer.println(points);
+    jo.println("operator new calls (100 printlns): ", g_new_calls - before);
+
+    ju::Printer<wcout_policy> wide;
+    jo.println("wide formatter matches: ", wide.to_string(Vec3{1, 2, 3}) == L"Vec3(1, 2, 3)");
+}
+
+// ==================== Field attributes ====================
+struct Packet {
+    uint32_t seq;
+    std::string token;
+    std::vector<uint8_t> payload;
+    std::vector<int> samples;
+    uint32_t checksum;
+    std::string note;
+    double ratio;
+};
+
+struct PercentFormatter {
+    template <typename Sink>
+    void format(Sink& out, double v) {
+        out.print(ju::fmt(v * 100, "{:.1f}"));
+        out.write("%");
+    }
+};
+
+template <>
+struct ju::field_attributes<Packet> {
+    static constexpr auto value = std::tuple{
+        ju::field::rename("seq", "sequence"),
+        ju::field::redact("token"),
+        ju::field::skip("payload"),
+        ju::field::truncate("samples", 3),
+        ju::field::format("checksum", "{:#010x}"),
+        ju::field::truncate("note", 5),
+        ju::field::format_with<PercentFormatter>("ratio"),
+    };
+};
+
+struct Secret {
+    std::string password;
+    int level;
+};
+
+template <>
+struct ju::field_attributes<Secret> {
+    static constexpr auto value = std::tuple{ju::field::skip("password")};
+};
+
+void test_field_attributes() {
+    print_section("Field attributes");
+
+    Packet p{7, "hunter2", std::vector<uint8_t>(1 << 20, 0xab), {1, 2, 3, 4, 5},
+             0xbeef, "a long note", 0.125};
+    jo.println(p);
+    jo.println("nested: ", std::vector{Secret{"pw", 1}, Secret{"pw2", 2}});
+
+    // Skipped fields cost nothing: the 1 MiB payload is never formatted
+    struct counting_policy {
+        using char_type = char;
+        size_t bytes = 0;
+        void write(std::string_view sv) { bytes += sv.size(); }
+    };
+    auto printer = ju::make_printer(counting_policy{});
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 1000; ++i) printer.println(p);
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    jo.println("bytes per println: ", printer.policy().bytes / 1000);
+    std::cout << "1000 printlns with a skipped 1 MiB member: " << us.count() << " us\n";
+}
+
+// ==================== Diff ====================
+struct Limit {
+    int min;
+    int max;
+};
+
+struct Config {
+    std::string name;
+    std::vector<Limit> limits;
+    std::map<std::string, int> weights;
+    std::unordered_map<int, std::string> labels;
+    std::set<std::string> tags;
+    std::optional<double> scale;
+    std::string api_key;
+};
+
+template <>
+struct ju::field_attributes<Config> {
+    static constexpr auto value = std::tuple{ju::field::redact("api_key")};
+};
+
+void test_diff() {
+    print_section("Diff");
+
+    Config before{"svc", {{0, 5}, {1, 10}, {2, 10}, {3, 10}},
+                  {{"a", 1}, {"b", 2}, {"c", 3}}, {{1, "one"}, {2, "two"}},
+                  {"blue", "green"}, 1.5, "k1"};
+    Config after = before;
+    after.limits[3].max = 20;
+    after.limits.push_back({4, 40});
+    after.weights.erase("b");
+    after.weights["d"] = 4;
+    after.weights["c"] = 30;
+    after.labels[2] = "deux";
+    after.labels[3] = "three";
+    after.tags.erase("blue");
+    after.tags.insert("red");
+    after.scale.reset();
+    after.api_key = "k2";
+
+    size_t changes = jo.print_diff(before, after, "cfg");
+    jo.println("changes: ", changes);
+    jo.println("identical snapshots: ", jo.print_diff(before, before, "cfg"));
+    jo.println("top-level scalars:");
+    jo.print_diff(1, 2);
+
+    // Unordered multi containers compare per-value counts, whatever the order
+    jo.println("multiset changes: ", jo.print_diff(std::unordered_multiset<int>{1, 1, 2},
+                                                   std::unordered_multiset<int>{1, 2, 2}, "bag"));
+    std::unordered_multimap<std::string, int> routes_a{{"x", 1}, {"x", 2}, {"y", 3}};
+    std::unordered_multimap<std::string, int> routes_b{{"x", 2}, {"x", 1}, {"y", 3}, {"y", 4}};
+    jo.println("multimap changes: ", jo.print_diff(routes_a, routes_b, "routes"));
+
+    // Character pointers compare by content, not address
+    struct Label {
+        const char* name;
+        int id;
+    };
+    char first[] = "abc", second[] = "abc";
+    jo.println("same text, other buffer: ", jo.print_diff(Label{first, 1}, Label{second, 1}, "label"));
+    second[0] = 'x';
+    jo.println("changed text: ", jo.print_diff(Label{first, 1}, Label{second, 1}, "label"));
+
+    // Equal subtrees are skipped through operator==
+    std::map<int, std::vector<int>> big_a, big_b;
+    for (int i = 0; i < 20000; ++i) big_a[i] = std::vector<int>(8, i);
+    big_b = big_a;
+    big_b[12345][7] = -1;
+    auto start = std::chrono::steady_clock::now();
+    jo.print_diff(big_a, big_b, "big");
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "diff of two 20000-entry maps: " << us.count() << " us\n";
+}
+
+// ==================== Cached printer ====================
+struct ServiceStatus {
+    std::string name;
+    std::vector<std::string> endpoints;
+    std::map<std::string, std::string> settings;
+    std::vector<double> calibration;
+    uint64_t requests;
+    double load;
+};
+
+struct Ticket {
+    int id;
+    std::string to_string() const { return "ticket #" + std::to_string(id); }
+};
+
+void test_cached_printer() {
+    print_section("Cached printer");
+
+    ServiceStatus status{"frontend", {}, {}, {}, 0, 0.0};
+    for (int i = 0; i < 64; ++i) {
+        status.endpoints.push_back("http://10.0.0." + std::to_string(i) + ":8080/api");
+        status.settings["key" + std::to_string(i)] = "value" + std::to_string(i * i);
+        status.calibration.push_back(i * 0.37);
+    }
+
+    struct string_sink {
+        using char_type = char;
+        std::string text;
+        void write(std::string_view sv) { text.append(sv); }
+    };
+    ju::cached_printer<string_sink> cached;
+    ju::Printer<string_sink> plain;
+
+    bool identical = true;
+    auto run = [&](auto& printer) {
+        auto start = std::chrono::steady_clock::now();
+        for (int tick = 0; tick < 2000; ++tick) {
+            status.requests = tick * 17;
+            status.load = tick % 10 * 0.1;
+            printer.policy().text.clear();
+            printer.println(status);
+        }
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    };
+    auto plain_us = run(plain);
+    auto cached_us = run(cached);
+    identical = cached.policy().text == plain.policy().text;
+    jo.println("cached output matches: ", identical);
+    jo.println("hits / misses: ", cached.hits(), " / ", cached.misses());
+    std::cout << "2000 ticks plain: " << plain_us.count() << " us, cached: " << cached_us.count() << " us\n";
+
+    status.endpoints[0] = "http://changed";
+    cached.policy().text.clear();
+    cached.println(status);
+    jo.println("change picked up: ", cached.policy().text.find("http://changed") != std::string::npos);
+
+    ju::cached_printer<string_sink> small(string_sink{}, 256);
+    small.println(status);
+    jo.println("bounded cache bytes <= 256: ", small.cached_bytes() <= 256);
+    cached.invalidate(&status);
+    jo.println("after invalidate: ", cached.cached_bytes());
+
+    // Aggregates with their own printing are not reflected member by member
+    auto same_as_plain = [&](const auto& obj) {
+        cached.policy().text.clear();
+        cached.print(obj);
+        return cached.policy().text == plain.to_string(obj);
+    };
+    auto number = ju::fmt(255, "{:#x}");
+    jo.println("formatter / eprint_format / to_string / formatted match: ", same_as_plain(Vec3{1, 2, 3}),
+               " ", same_as_plain(shop::Money{1999, "EUR"}), " ", same_as_plain(Ticket{7}), " ",
+               same_as_plain(number));
+
+    // Smart pointers are re-hashed through the pointee and the use count
+    auto shared = std::make_shared<int>(5);
+    auto cached_text = [&] {
+        cached.policy().text.clear();
+        cached.print(shared);
+        return cached.policy().text;
+    };
+    cached_text();
+    auto copy = shared;
+    bool count_seen = cached_text() == plain.to_string(shared);
+    *shared = 6;
+    bool value_seen = cached_text() == plain.to_string(shared);
+    jo.println("shared_ptr use_count / pointee change picked up: ", count_seen, " ", value_seen);
+
+    // Changing the options through options() drops text formatted under the old ones
+    struct Reading {
+        double ratio;
+        int n;
+    };
+    Reading reading{0.123456789, 5};
+    same_as_plain(reading);
+    for (auto* opts : {&cached.options(), &plain.options()}) {
+        opts->float_format = ju::format_spec("{:.2f}");
+        opts->integer_format = ju::format_spec("{:#x}");
+    }
+    jo.println("option change picked up: ", same_as_plain(reading), ", text: ", cached.policy().text);
+}
+
+// ==================== Parse ====================
+struct Trade {
+    uint64_t id;
+    std::string symbol;
+    double price;
+    int quantity;
+    bool buy;
+    std::optional<std::string> note;
+    std::vector<int> fills;
+};
+
+void test_parse() {
+    print_section("Parse");
+
+    auto v = ju::parse<std::vector<int>>(jo.to_string(std::vector{1, 2, 3}));
+    jo.println("vector<int>: ", v);
+    auto m = ju::parse<std::map<std::string, std::vector<double>>>(R"({ "a": [1.5, 2], "b": [] })");
+    jo.println("map<string, vector<double>>: ", m);
+    auto p = ju::parse<std::pair<char, long>>("(A, 100)");
+    jo.println("pair<char, long>: ", p);
+    auto t = ju::parse<std::tuple<int, std::string_view, std::optional<int>>>(R"((1, "zero copy", None))");
+    jo.println("tuple with string_view: ", t);
+    jo.println("malformed: ", ju::parse<std::vector<int>>("[1, 2,"));
+    jo.println("hex: ", ju::parse<uint32_t>("0xdeadbeef"));
+
+    Trade trade{42, "ACME", 101.25, -300, true, "late fill", {100, 200}};
+    auto text = jo.to_string(trade);
+    auto back = ju::parse<Trade>(text);
+    jo.println("aggregate round trip: ", back && jo.to_string(*back) == text);
+
+    ju::Printer<cout_policy> pretty;
+    pretty.options().pretty_width = 20;
+    auto pretty_back = ju::parse<Trade>(pretty.to_string(trade));
+    jo.println("pretty round trip: ", pretty_back && jo.to_string(*pretty_back) == text);
+
+    jo.println("field attributes skip redacted/truncated: ",
+               ju::parse<Packet>(jo.to_string(Packet{7, "x", {1}, {1, 2, 3, 4}, 9, "n", 0.5})).has_value());
+
+    std::vector<Trade> book;
+    for (int i = 0; i < 100000; ++i) {
+        book.push_back({uint64_t(i), "SYM" + std::to_string(i % 97), 100 + i % 1000 * 0.25, i % 500 - 250,
+                        i % 2 == 0, i % 3 == 0 ? std::optional<std::string>("n") : std::nullopt, {i, i + 1}});
+    }
+    std::string dump = jo.to_string(book);
+    auto start = std::chrono::steady_clock::now();
+    auto parsed = ju::parse<std::vector<Trade>>(dump);
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    jo.println("100000 trades round trip: ", parsed && jo.to_string(*parsed) == dump);
+    std::cout << "parsed " << dump.size() / 1000000.0 << " MB at "
+              << dump.size() / std::max<double>(us.count(), 1) << " MB/s\n";
+}
+
+// ==================== Ring policy ====================
+static ring_policy* g_recorder = nullptr;
+static int g_dump_fd = -1;
+
+extern "C" void dump_recorder(int) {
+    g_recorder->dump(g_dump_fd);
+}
+
+void test_ring_policy() {
+    print_section("Ring policy");
+
+    ring_policy ring(4096);
+    auto recorder = ju::make_printer(ring);
+    for (int i = 0; i < 1000; ++i) {
+        recorder.println("line ", i, ": ", std::vector{i, i * 2});
+    }
+    std::string kept = ring.snapshot();
+    jo.println("capacity: ", ring.capacity(), ", written: ", ring.written(), ", kept: ", kept.size());
+    jo.println("starts at a line: ", kept.starts_with("line "));
+    jo.println("ends with last line: ", kept.ends_with("line 999: [999, 1998]\n"));
+
+    std::FILE* file = std::tmpfile();
+    g_recorder = &ring;
+    g_dump_fd = fileno(file);
+    auto previous = std::signal(SIGUSR1, dump_recorder);
+    std::raise(SIGUSR1);
+    std::signal(SIGUSR1, previous);
+    std::rewind(file);
+    std::string dumped(kept.size() + 1, '\0');
+    dumped.resize(std::fread(dumped.data(), 1, dumped.size(), file));
+    std::fclose(file);
+    jo.println("dump from signal handler matches snapshot: ", dumped == kept);
+
+    // Staging is per ring, and an unterminated line shows up in dumps
+    ring_policy first_ring(4096), second_ring(4096);
+    first_ring.write("abc");
+    second_ring.write("def\n");
+    first_ring.write("ghi\n");
+    jo.println("rings kept apart: ", first_ring.snapshot() == "abcghi\n" && second_ring.snapshot() == "def\n");
+    first_ring.write("about to crash");
+    jo.println("unterminated line in snapshot: ", first_ring.snapshot() == "abcghi\nabout to crash\n",
+               ", committed bytes: ", first_ring.written());
+
+    ring_policy big(1 << 20);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&big, t] {
+            auto local = ju::make_printer(big);
+            for (int i = 0; i < 50000; ++i) local.println("thread ", t, " event ", i);
+        });
+    }
+    for (auto& th : threads) th.join();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    jo.println("concurrent bytes written: ", big.written());
+    std::cout << "4 threads x 50000 printlns: " << ns.count() / 200000 << " ns per println\n";
+
+    // Every retained line is whole: "thread <t> event <i>", and each
+    // thread's events stay in order
+    std::istringstream retained(big.snapshot());
+    std::string text;
+    size_t lines = 0, corrupt = 0;
+    int last[4] = {-1, -1, -1, -1};
+    while (std::getline(retained, text)) {
+        ++lines;
+        int t = -1, i = -1;
+        char tail = 0;
+        if (std::sscanf(text.c_str(), "thread %d event %d%c", &t, &i, &tail) != 2 || t < 0 || t > 3 ||
+            text != "thread " + std::to_string(t) + " event " + std::to_string(i) || i <= last[t]) {
+            ++corrupt;
+            continue;
+        }
+        last[t] = i;
+    }
+    jo.println("retained lines intact: ", corrupt == 0, " (", lines > 10000, ")");
+}
+
+// ==================== Rotating files ====================
+void test_rotating_file_policy() {
+    print_section("Rotating file policy");
+
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / "eprint_rotate_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    std::atomic<size_t> handed_off{0};
+    std::vector<long long> latencies;
+    latencies.reserve(200000);
+    size_t rotations = 0;
+    {
+        rotating_file_policy files({.path = dir / "app.log",
+                                    .max_bytes = 256 * 1024,
+                                    .generations = 3,
+                                    .on_rotated = [&](const fs::path&) { ++handed_off; }});
+        auto log = ju::make_printer(files);
+        for (int i = 0; i < 200000; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            log.println("event ", i, " values ", std::array{i, i + 1, i + 2});
+            latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count());
+        }
+        rotations = files.rotations();
+    }
+    size_t files_kept = std::distance(fs::directory_iterator(dir), fs::directory_iterator{});
+    jo.println("rotated at least 10 times: ", rotations >= 10);
+    jo.println("on_rotated calls match: ", handed_off == rotations);
+    jo.println("files kept (active + 3): ", files_kept);
+    std::ifstream active(dir / "app.log.1");
+    std::string first_line;
+    std::getline(active, first_line);
+    jo.println("rotated file starts at a line: ", first_line.starts_with("event "));
+
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << "println latency p50: " << latencies[latencies.size() / 2]
+              << " ns, p99.9: " << latencies[latencies.size() * 999 / 1000]
+              << " ns, max: " << latencies.back() << " ns\n";
+    fs::remove_all(dir);
+}
+
+// ==================== Tee ====================
+void test_tee_policy() {
+    print_section("Tee policy");
+
+    struct string_sink {
+        using char_type = char;
+        std::string text;
+        size_t writes = 0;
+        void write(std::string_view sv) { text.append(sv); ++writes; }
+    };
+    struct wstring_sink {
+        using char_type = wchar_t;
+        std::wstring text;
+        void write(std::wstring_view sv) { text.append(sv); }
+    };
+    string_sink console, errors;
+    wstring_sink wide;
+    auto tee = ju::make_printer(tee_policy(console, wide, errors));
+    tee.policy().sink_level<2>(ju::level::warn);
+
+    std::map<std::string, std::vector<int>> data{{"a", {1, 2}}, {"b", {3}}};
+    tee.println("data: ", data);
+    tee.policy().level(ju::level::error);
+    tee.println("failure: ", 42);
+    tee.policy().level(ju::level::info);
+
+    jo.println("console: ", console.text);
+    jo.println("one write per println: ", console.writes == 2);
+    jo.println("wide copy matches: ", wide.text == std::wstring(console.text.begin(), console.text.end()));
+    jo.println("warn+ sink: ", errors.text);
+
+    // Non-ASCII text is converted between UTF-8 and the wide encoding
+    {
+        string_sink narrow;
+        wstring_sink converted;
+        auto utf = ju::make_printer(tee_policy(narrow, converted));
+        utf.println("Zoë 日本 🎉");
+        jo.println("wide copy decodes UTF-8: ", converted.text == L"Zoë 日本 🎉\n");
+
+        struct u16_sink {
+            using char_type = char16_t;
+            std::u16string text;
+            void write(std::u16string_view sv) { text.append(sv); }
+        };
+        wstring_sink source_side;
+        string_sink back;
+        u16_sink utf16;
+        auto from_wide = ju::make_printer(tee_policy(source_side, back, utf16));
+        from_wide.print(std::wstring(L"Zoë 日本 🎉"));
+        jo.println("UTF-8 copy of wide text: ", back.text, ", UTF-16 copy: ", utf16.text == u"Zoë 日本 🎉");
+    }
+
+    // Formatting once vs two printers
+    std::vector<std::map<std::string, std::vector<int>>> rows(200, data);
+    string_sink s1, s2;
+    auto a = ju::make_printer(s1);
+    auto b = ju::make_printer(s2);
+    auto both = ju::make_printer(tee_policy(string_sink{}, string_sink{}));
+    auto time = [](auto&& f) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < 200; ++i) f();
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    };
+    auto separate = time([&] {
+        s1.text.clear();
+        s2.text.clear();
+        a.println(rows);
+        b.println(rows);
+    });
+    auto teed = time([&] {
+        both.policy().sink<0>().text.clear();
+        both.policy().sink<1>().text.clear();
+        both.println(rows);
+    });
+    jo.println("same text: ", s1.text == both.policy().sink<1>().text);
+    std::cout << "two printers: " << separate << " us, tee: " << teed << " us\n";
+}
+
+// ==================== Socket policy ====================
+void test_socket_policy() {
+    print_section("Socket policy");
+
+    // UDP loopback listener on an ephemeral port
+    int rx = ::socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    ::bind(rx, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    ::getsockname(rx, reinterpret_cast<sockaddr*>(&addr), &len);
+    int rcvbuf = 1 << 20;
+    ::setsockopt(rx, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    std::string expected;
+    size_t calls = 0;
+    {
+        socket_policy udp({.kind = socket_policy::transport::udp, .port = ntohs(addr.sin_port), .max_datagram = 512});
+        auto net = ju::make_printer(udp);
+        for (int i = 0; i < 200; ++i) {
+            net.println("line ", i, ": ", std::vector{i, i * i});
+            expected += "line " + std::to_string(i) + ": [" + std::to_string(i) + ", " + std::to_string(i * i) + "]\n";
+        }
+        udp.sync();
+        calls = udp.send_calls();
+    }
+    std::string received;
+    size_t datagrams = 0, largest = 0;
+    char buf[2048];
+    for (ssize_t n; (n = ::recv(rx, buf, sizeof(buf), MSG_DONTWAIT)) > 0; ++datagrams) {
+        received.append(buf, n);
+        largest = std::max<size_t>(largest, n);
+    }
+    ::close(rx);
+    jo.println("udp payload matches: ", received == expected);
+    jo.println("udp datagrams <= 512 bytes: ", largest <= 512, ", lines per datagram > 1: ", datagrams < 200);
+    jo.println("send calls < datagrams: ", calls < datagrams);
+
+    // Low rate: a line after a quiet period goes out without sync(), later
+    // ones within max_delay wait for the next print
+    rx = ::socket(AF_INET, SOCK_DGRAM, 0);
+    addr.sin_port = 0;
+    ::bind(rx, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    ::getsockname(rx, reinterpret_cast<sockaddr*>(&addr), &len);
+    {
+        socket_policy udp({.kind = socket_policy::transport::udp, .port = ntohs(addr.sin_port),
+                           .max_delay = std::chrono::milliseconds(20)});
+        auto net = ju::make_printer(udp);
+        auto receive = [&] {
+            std::string got;
+            for (ssize_t n; (n = ::recv(rx, buf, sizeof(buf), MSG_DONTWAIT)) > 0;) got.append(buf, n);
+            return got;
+        };
+        net.println("first");
+        std::string quiet = receive();
+        net.println("second");
+        std::string held = receive();
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        net.println("third");
+        jo.println("quiet line sent at once: ", quiet == "first\n", ", burst held: ", held.empty(),
+                   ", sent after max_delay: ", receive() == "second\nthird\n");
+
+        // A datagram the socket rejects for good is dropped, not retried forever
+        socket_policy big({.kind = socket_policy::transport::udp, .port = ntohs(addr.sin_port),
+                           .max_datagram = 100000});
+        auto big_net = ju::make_printer(big);
+        big_net.println(std::string(70000, 'x'));
+        big.sync();
+        big_net.println("after oversize");
+        big.sync();
+        jo.println("oversize datagram dropped: ", big.dropped_lines(), ", next line sent: ",
+                   receive() == "after oversize\n");
+    }
+    ::close(rx);
+
+    try {
+        socket_policy named({.kind = socket_policy::transport::udp, .host = "localhost"});
+        jo.println("host name accepted");
+    } catch (const std::system_error& e) {
+        jo.println("host name rejected: ", e.what());
+    }
+
+    // TCP loopback
+    int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    addr.sin_port = 0;
+    ::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    ::getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len);
+    ::listen(listener, 1);
+    {
+        socket_policy tcp({.kind = socket_policy::transport::tcp, .port = ntohs(addr.sin_port)});
+        int peer = ::accept(listener, nullptr, nullptr);
+        auto net = ju::make_printer(tcp);
+        net.println("over tcp: ", std::map<int, std::string>{{1, "one"}});
+        tcp.sync();
+        ssize_t n = ::recv(peer, buf, sizeof(buf), 0);
+        jo.println("tcp received: ", std::string_view(buf, n > 0 ? n : 0));
+        ::close(peer);
+    }
+    ::close(listener);
+
+    // Unix datagram collector that never reads: backpressure, then drops
+    std::string path = (std::filesystem::temp_directory_path() / "eprint_collector.sock").string();
+    ::unlink(path.c_str());
+    int collector = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+    sockaddr_un uaddr{};
+    uaddr.sun_family = AF_UNIX;
+    std::strncpy(uaddr.sun_path, path.c_str(), sizeof(uaddr.sun_path) - 1);
+    ::bind(collector, reinterpret_cast<sockaddr*>(&uaddr), sizeof(uaddr));
+    {
+        socket_policy unix_sock({.kind = socket_policy::transport::unix_dgram, .path = path,
+                                 .max_pending = 16 * 1024});
+        auto net = ju::make_printer(unix_sock);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < 100000; ++i) net.println("flood ", i);
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        jo.println("stalled collector drops lines: ", unix_sock.dropped_lines() > 0);
+        jo.println("never blocked (< 2 s): ", ms.count() < 2000);
+    }
+    ::close(collector);
+    ::unlink(path.c_str());
+}
+
+// ==================== Compile-time formatting ====================
+enum class Mode { idle, running, stopped };
+
+struct Endpoint {
+    ju::fixed_string<9> host;
+    uint16_t port;
+};
+
+struct ServiceConfig {
+    ju::fixed_string<7> name;
+    Mode mode;
+    int retries;
+    double timeout;
+    bool tls;
+    std::array<Endpoint, 2> endpoints;
+    std::array<float, 3> weights;
+    uint64_t secret;
+};
+
+template <>
+struct ju::field_attributes<ServiceConfig> {
+    static constexpr auto value = std::tuple{ju::field::redact("secret"), ju::field::rename("retries", "max_retries")};
+};
+
+struct Banner {
+    ju::fixed_string<11> title;
+    std::array<int, 5> codes;
+    int id;
+};
+
+template <>
+struct ju::field_attributes<Banner> {
+    static constexpr auto value = std::tuple{ju::field::truncate("title", 5), ju::field::truncate("codes", 2)};
+};
+
+constexpr Banner kBanner{"maintenance", {1, 2, 3, 4, 5}, 7};
+
+constexpr ServiceConfig kConfig{"backend", Mode::running, 3, 2.5, true,
+                                {{{"localhost", 8080}, {"127.0.0.1", 9090}}}, {0.5f, 0.25f, 1e-7f}, 0xdeadbeef};
+
+void test_ct_format() {
+    print_section("Compile-time formatting");
+
+    constexpr auto text = ju::ct_format<kConfig>();
+    static_assert(text.view().find("mode: running") != std::string_view::npos);
+    static_assert(ju::ct_format<42>().view() == "42");
+    static_assert(ju::ct_format<-1.5e-7>().view() == "-1.5e-07");
+    static_assert(ju::ct_format<Mode::stopped>().view() == "stopped");
+    static_assert(ju::ct_format<static_cast<Mode>(7)>().view() == "7");
+
+    jo.println(ju::ct_text<kConfig>);
+    jo.println("endpoints match runtime print: ",
+               jo.to_string(ju::ct_text<kConfig.endpoints>) == jo.to_string(kConfig.endpoints));
+    jo.println(ju::ct_text<kBanner>);
+    jo.println("truncated members match runtime print: ", jo.to_string(ju::ct_text<kBanner>) == jo.to_string(kBanner));
+
+    bool floats_match = true;
+    auto check = [&]<double V>() { floats_match &= ju::ct_format<V>().view() == jo.to_string(V); };
+    check.template operator()<0.1>();
+    check.template operator()<123456.0>();
+    check.template operator()<1234567.0>();
+    check.template operator()<0.0001>();
+    check.template operator()<0.00001234>();
+    check.template operator()<3.14159265>();
+    check.template operator()<-2e100>();
+    check.template operator()<999999.5>();
+    jo.println("float text matches to_chars: ", floats_match);
+}
+
+// ==================== Chunk reader ====================
+void test_chunk_reader() {
+    print_section("Chunk reader");
+
+    std::map<std::string, std::vector<int>> data;
+    for (int i = 0; i < 1000; ++i) data["key" + std::to_string(i)] = {i, i * 2, i * 3};
+    std::string expected = jo.to_string(data);
+
+    std::string joined;
+    size_t chunks = 0, largest = 0;
+    {
+        ju::chunk_reader reader(data, 1000);
+        for (auto chunk = reader.next(); !chunk.empty(); chunk = reader.next()) {
+            joined += chunk;
+            largest = std::max(largest, chunk.size());
+            ++chunks;
+        }
+    }
+    jo.println("chunks: ", chunks, ", largest: ", largest, ", matches to_string: ", joined == expected);
+
+    // Abandoning a reader part way cancels the traversal
+    {
+        ju::chunk_reader reader(data, 64);
+        reader.next();
+        reader.next();
+    }
+    { ju::chunk_reader unread(data, 64); }
+    jo.println("early destruction ok: ", true);
+
+    // A formatting exception on the producer thread is rethrown by next()
+    struct Faulty {
+        int id;
+        std::string to_string() const {
+            if (id == 500) throw std::runtime_error("element 500 failed");
+            return std::to_string(id);
+        }
+    };
+    std::vector<Faulty> faulty(1000);
+    for (int i = 0; i < 1000; ++i) faulty[i].id = i;
+    size_t before_error = 0;
+    {
+        ju::chunk_reader reader(faulty, 64);
+        try {
+            for (auto chunk = reader.next(); !chunk.empty(); chunk = reader.next()) before_error += chunk.size();
+            jo.println("no exception");
+        } catch (const std::runtime_error& e) {
+            jo.println("rethrown by next(): ", e.what(), ", then done: ", reader.done(),
+                       ", next empty: ", reader.next().empty());
+        }
+    }
+    { ju::chunk_reader unread(faulty, 1 << 16); } // fails before its first chunk fills
+    jo.println("chunks before the error: ", before_error / 64, ", unread failing reader destroyed: ", true);
+
+    // 20M elements streamed through one 64 KiB chunk buffer
+    std::vector<int> huge(20'000'000);
+    std::iota(huge.begin(), huge.end(), 0);
+    size_t before = g_new_calls;
+    size_t total = 0;
+    auto start = std::chrono::steady_clock::now();
+    {
+        ju::chunk_reader reader(huge, 64 * 1024);
+        for (auto chunk = reader.next(); !chunk.empty(); chunk = reader.next()) total += chunk.size();
+    }
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    jo.println("streamed bytes: ", total, ", operator new calls: ", g_new_calls - before);
+    std::cout << "streamed " << total / 1000000 << " MB in " << ms.count() << " ms\n";
+}
+
+// ==================== Table ====================
+struct StaffRecord {
+    std::string name;
+    int age;
+    std::string department;
+    double salary;
+    bool remote;
+    std::vector<std::string> skills;
+};
+
+void test_table() {
+    print_section("Table");
+
+    std::vector<StaffRecord> staff{
+        {"Alice", 30, "Engineering", 125000.5, true, {"C++", "Python"}},
+        {"Bob", 45, "Sales", 98000, false, {}},
+        {"Carol", 28, "Research", 143250.75, true, {"Rust"}},
+    };
+    jo.println(ju::table(staff));
+    jo.println(ju::table(std::vector<Packet>{{1, "t", {}, {1, 2, 3, 4}, 0xab, "note", 0.5}}));
+
+    // Columns line up by display width: accents take one column, CJK two
+    std::vector<StaffRecord> names{
+        {"Zoë", 33, "Design", 91000, true, {}},
+        {"山田太郎", 51, "Operations", 87000, false, {}},
+        {"Ana", 26, "Support", 52000, true, {"日本語"}},
+    };
+    auto aligned = jo.to_string(ju::table(names));
+    jo.println(aligned);
+    jo.println("aligned by display width: ", aligned ==
+               "name       | age | department   | salary | remote | skills\n"
+               "-----------+-----+--------------+--------+--------+-----------\n"
+               "\"Zoë\"      |  33 | \"Design\"     |  91000 |      1 | []\n"
+               "\"山田太郎\" |  51 | \"Operations\" |  87000 |      0 | []\n"
+               "\"Ana\"      |  26 | \"Support\"    |  52000 |      1 | [\"日本語\"]");
+
+    std::vector<StaffRecord> many;
+    for (int i = 0; i < 20000; ++i) {
+        many.push_back({"employee" + std::to_string(i), 20 + i % 40, i % 2 ? "Engineering" : "Operations",
+                        50000.0 + i, i % 3 == 0, {"skill" + std::to_string(i % 7)}});
+    }
+    std::string plain, tabular;
+    auto time = [](auto&& f) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    };
+    // Best of five: a single cold run is dominated by allocation noise
+    long long plain_us = LLONG_MAX, table_us = LLONG_MAX;
+    for (int run = 0; run < 5; ++run) {
+        plain_us = std::min<long long>(plain_us, time([&] { plain = jo.to_string(many); }));
+        table_us = std::min<long long>(table_us, time([&] { tabular = jo.to_string(ju::table(many)); }));
+    }
+    jo.println("size ratio (list / table): ", ju::fmt(double(plain.size()) / tabular.size(), "{:.2f}"));
+    std::cout << "20000 rows list: " << plain_us << " us, table: " << table_us << " us\n";
+}
+
+// ==================== Test: Summary ====================
+void test_summary() {
+    print_section("Summary");
+
+    jo.println(ju::summary(std::vector<int>{}));
+    jo.println(ju::summary(std::vector<int>{4, 8, 15, 16, 23, 42}));
+    jo.println(ju::summary(std::list<float>{1.5f, NAN, 2.5f}));
+
+    // Sum of twelve uniforms: roughly normal with mean 0 and stddev 1
+    std::vector<double> samples(10'000'000);
+    uint64_t state = 88172645463325252ull;
+    auto uniform = [&] {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return (state >> 11) * 0x1.0p-53;
+    };
+    for (auto& x : samples) {
+        double s = 0;
+        for (int k = 0; k < 12; ++k) s += uniform();
+        x = s - 6;
+    }
+    for (size_t i = 0; i < samples.size(); i += 100000) samples[i] = NAN;
+
+    auto time = [](auto&& f) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    };
+    std::string text;
+    auto summary_ms = time([&] { text = jo.to_string(ju::summary(samples)); });
+    std::cout << text << "\n";
+
+    double naive = 0;
+    size_t valid = 0;
+    auto naive_ms = time([&] {
+        for (double x : samples) {
+            if (x == x) naive += x, ++valid;
+        }
+    });
+    std::cout << "10M samples summary: " << summary_ms << " ms, naive mean loop: " << naive_ms
+              << " ms, naive mean: " << naive / valid << "\n";
+
+    ju::Printer<cout_policy> printer;
+    printer.options().parallel_threshold = 1024;
+    printer.options().parallel_threads = 4;
+    jo.println("parallel identical counts: ",
+               printer.to_string(ju::summary(samples)).substr(0, 30) == text.substr(0, 30));
+}
+
+// ==================== Test: Hexdump ====================
+void test_hexdump() {
+    print_section("Hexdump");
+
+    std::string text = "GET /index.html HTTP/1.1\r\nHost: a\r\n";
+    std::vector<uint8_t> packet(text.begin(), text.end());
+    jo.println(ju::hexdump(packet));
+    jo.println(ju::hexdump(std::span<const char>(text.data(), 5), ju::hexdump_style::compact));
+    jo.println(std::array<std::byte, 4>{std::byte{0x0c}, std::byte{0x00}, std::byte{0xff}, std::byte{0x41}});
+    jo.println(std::byte{0x7f}, " ", ju::hexdump(std::vector<uint8_t>{}));
+
+    ju::Printer<cout_policy> printer;
+    printer.options().bytes_as_hex = true;
+    printer.println(std::vector<uint8_t>{12, 0, 255});
+
+    struct counting_policy {
+        using char_type = char;
+        size_t bytes = 0;
+        void write(std::string_view sv) { bytes += sv.size(); }
+    };
+    std::vector<uint8_t> blob(64 << 20);
+    for (size_t i = 0; i < blob.size(); ++i) blob[i] = static_cast<uint8_t>(i * 2654435761u >> 13);
+    auto counter = ju::make_printer(counting_policy{});
+    auto throughput = [&](ju::hexdump_style style) {
+        auto start = std::chrono::steady_clock::now();
+        counter.print(ju::hexdump(blob, style));
+        auto s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return ju::fmt(blob.size() / s / 1e9, "{:.2f}");
+    };
+    jo.println("64 MiB compact: ", throughput(ju::hexdump_style::compact), " GB/s, rows: ",
+               throughput(ju::hexdump_style::rows), " GB/s");
+}
+
+// ==================== Test: Printer Stats ====================
+void test_printer_stats() {
+    print_section("Printer Stats");
+
+    struct counting_policy {
+        using char_type = char;
+        size_t bytes = 0;
+        void write(std::string_view sv) { bytes += sv.size(); }
+    };
+    auto printer = ju::make_printer(counting_policy{});
+    std::vector<int> values(100, 7);
+    std::map<std::string, int> ages{{"alice", 30}, {"bob", 45}};
+    for (int i = 0; i < 1000; ++i) {
+        printer.println("iteration ", i, ": ", values, ages, 3.5);
+    }
+
+    auto stats = printer.stats();
+    if constexpr (ju::stats_enabled) {
+        jo.println("calls: ", stats.calls, ", chars match policy: ", stats.chars == printer.policy().bytes,
+                   ", writes: ", stats.writes, ", families: ", stats.families);
+        jo.println("format ms: ", stats.format_ns / 1000000, ", write ms: ", stats.write_ns / 1000000);
+
+        // Moving keeps the counters; pretty mode still counts arguments by family
+        auto moved = std::move(printer);
+        jo.println("calls after move: ", moved.stats().calls, ", left behind: ", printer.stats().calls);
+        moved.reset_stats();
+        jo.println("after reset: ", moved.stats().calls);
+        size_t bytes_before = moved.policy().bytes;
+        moved.print<int>();
+        moved.println<std::vector<int>>();
+        jo.println("type name calls: ", moved.stats().calls,
+                   ", chars match policy: ", moved.stats().chars == moved.policy().bytes - bytes_before);
+        moved.reset_stats();
+        moved.options().pretty_width = 40;
+        moved.println(values, ages, 3.5);
+        auto pretty = moved.stats().families;
+        jo.println("pretty mode arguments: ranges ", pretty.ranges.arguments, ", maps ", pretty.maps.arguments,
+                   ", numbers ", pretty.numbers.arguments);
+    } else {
+        jo.println("stats disabled, all zero: ", stats.calls == 0 && stats.chars == 0 && stats.writes == 0);
+    }
+    jo.println(ju::printer_stats{});
+}
+
+// ==================== Test: Sorted Unordered Containers ====================
+struct CopyCounted {
+    static inline int copies = 0;
+    int value;
+    explicit CopyCounted(int v) : value(v) {}
+    CopyCounted(const CopyCounted& other) : value(other.value) { ++copies; }
+    std::string to_string() const { return "#" + std::to_string(value); }
+};
+
+void test_sorted_unordered() {
+    print_section("Sorted Unordered Containers");
+
+    ju::Printer<cout_policy> printer;
+    printer.options().sort_unordered = true;
+    printer.println(std::unordered_map<int, std::string>{{3, "c"}, {-1, "a"}, {2, "b"}});
+    printer.println(std::unordered_set<std::string>{"pear", "apple", "fig"});
+    printer.println(std::unordered_multimap<std::string, int>{{"b", 1}, {"a", 2}, {"a", 1}});
+
+    // NaN keys do not break the order: they go last, and the rest is sorted
+    std::unordered_set<double> floats{NAN, -0.0};
+    for (int i = 0; i < 700; ++i) floats.insert((i * 7919 % 1400 - 700) * 0.25);
+    std::unordered_set<double> floats_rebuilt(floats.begin(), floats.end(), floats.bucket_count() * 8);
+    auto float_text = printer.to_string(floats);
+    std::vector<double> finite(floats.begin(), floats.end());
+    std::erase_if(finite, [](double x) { return x != x; });
+    std::sort(finite.begin(), finite.end());
+    auto expected_floats = jo.to_string(finite);
+    expected_floats.insert(expected_floats.size() - 1, ", nan");
+    jo.println("floats sorted with NaN last: ", float_text == expected_floats,
+               ", reproducible: ", float_text == printer.to_string(floats_rebuilt));
+
+    std::unordered_map<int, CopyCounted> tracked;
+    for (int i = 0; i < 500; ++i) tracked.emplace(i * 37 % 500 - 250, CopyCounted(i));
+    CopyCounted::copies = 0;
+    auto text = printer.to_string(tracked);
+    jo.println("element copies while sorting: ", CopyCounted::copies, ", starts with: ", text.substr(0, 24));
+
+    // Same bytes as an ordered copy, and independent of insertion history
+    std::unordered_set<int64_t> forward, backward;
+    for (int64_t i = 0; i < 1'000'000; ++i) forward.insert(i * 2654435761 % 4000037 - 2000000);
+    for (auto it = forward.begin(); it != forward.end(); ++it) backward.insert(*it);
+    backward.rehash(backward.bucket_count() * 4);
+    std::set<int64_t> ordered(forward.begin(), forward.end());
+
+    auto time = [](auto&& f) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    };
+    std::string sorted_text, copy_text, hash_text;
+    auto sorted_ms = time([&] { sorted_text = printer.to_string(forward); });
+    auto copy_ms = time([&] { copy_text = jo.to_string(std::set<int64_t>(forward.begin(), forward.end())); });
+    auto hash_ms = time([&] { hash_text = jo.to_string(forward); });
+    jo.println("matches std::set: ", sorted_text == jo.to_string(ordered),
+               ", independent of history: ", sorted_text == printer.to_string(backward),
+               ", hash order differs: ", hash_text != sorted_text);
+    std::cout << "1M int64 keys: sorted " << sorted_ms << " ms, copy into std::set " << copy_ms
+              << " ms, hash order " << hash_ms << " ms\n";
+}
+
 int main() {
     std::cout << "==============================================\n";
     std::cout << "    eprint Library Test Suite (New API)       \n";
@@ -451,6 +1832,28 @@ int main() {
     test_chrono_time_point();
     test_type_name_api();
     test_custom_printer();
+    test_parallel_format();
+    test_allocations();
+    test_pretty_print();
+    test_deep_pointers();
+    test_vocabulary_types();
+    test_format_spec();
+    test_user_formatter();
+    test_field_attributes();
+    test_diff();
+    test_cached_printer();
+    test_parse();
+    test_ring_policy();
+    test_rotating_file_policy();
+    test_tee_policy();
+    test_socket_policy();
+    test_ct_format();
+    test_chunk_reader();
+    test_table();
+    test_summary();
+    test_hexdump();
+    test_printer_stats();
+    test_sorted_unordered();
     std::cout << "\n==============================================\n";
     std::cout << "              All Tests Completed!            \n";
     std::cout << "==============================================\n";